@@ -1,13 +1,38 @@
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
+#include <new>
 #include <utility>
 #include <vector>
 
 #include "benchmark/MathBench.hpp"
+#include "benchmark/RasterBench.hpp"
+#include "benchmark/SceneBench.hpp"
 #include "utils/GitHelper.hpp"
 #include "utils/Measure.hpp"
 #define BENCH(x) BenchHelper::bench(x, #x)
 using namespace std;
+// every heap allocation of the bench, for the allocation checks, the array
+// and nothrow forms of the library forward to these two
+static std::atomic<long long> allocations{0};
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+// gcc pairs the inlined free() with the call to operator new at every site
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
 namespace BenchHelper {
 vector<pair<string, int64_t>> bench_result;
 int64_t bench(std::function<void()> func, std::string func_name) {
@@ -26,6 +51,54 @@ void writeToFile(const std::string& filename) {
 }
 };  // namespace BenchHelper
 int main() {
+    if (RasterBench::checkRasterKernels() != 0) {
+        std::cerr << "simd raster kernels disagree with the scalar one\n";
+        return 1;
+    }
+    if (RasterBench::checkVertexKernels() != 0) {
+        std::cerr << "simd vertex kernels disagree with the scalar one\n";
+        return 1;
+    }
+    if (RasterBench::checkShadeKernels() != 0) {
+        std::cerr << "simd shade kernels disagree with the scalar one\n";
+        return 1;
+    }
+    if (RasterBench::checkSpecularPow() != 0) {
+        std::cerr << "the specular pow approximation is off\n";
+        return 1;
+    }
+    if (SceneBench::checkSpecularPowImage("rem") != 0) {
+        std::cerr << "the specular pow approximation changes the image\n";
+        return 1;
+    }
+    if (RasterBench::checkFillRule() != 0) {
+        std::cerr << "shared edges are not covered exactly once\n";
+        return 1;
+    }
+    if (RasterBench::checkRectCoverage() != 0) {
+        std::cerr << "tiles are trivially rejected or accepted wrongly\n";
+        return 1;
+    }
+    ll visibility_mismatches = 0;
+    for (auto scene : {"rem", "mug"}) {
+        visibility_mismatches += SceneBench::checkVisibilityBuffer(
+            scene, Rasterizer::AAMode::NONE, 1, true);
+        visibility_mismatches += SceneBench::checkVisibilityBuffer(
+            scene, Rasterizer::AAMode::SSAA, 4, true);
+        for (int samples : {4, 16}) {
+            visibility_mismatches += SceneBench::checkVisibilityBuffer(
+                scene, Rasterizer::AAMode::MSAA, samples, true);
+        }
+    }
+    if (visibility_mismatches != 0) {
+        std::cerr << "the visibility buffer shades other fragments than "
+                     "forward shading\n";
+        return 1;
+    }
+    if (SceneBench::checkFrameAllocations("rem", allocations) != 0) {
+        std::cerr << "rendering a frame allocates\n";
+        return 1;
+    }
     BENCH(Mat4xMat4_100000);
     BENCH(Mat4xMat4_10000000);
     BENCH(Mat4xMat4_100000000);
@@ -37,6 +110,38 @@ int main() {
     BENCH(Mat4Inv_10000);
     BENCH(Mat4Inv_1000000);
 
+    BENCH(RasterBlockScalar_10000000);
+    BENCH(RasterBlockDispatch_10000000);
+
+    BENCH(VertexBlockScalar_10000000);
+    BENCH(VertexBlockDispatch_10000000);
+
+    BENCH(ShadePacketScalar_100000);
+    BENCH(ShadePacketDispatch_100000);
+    BENCH(ShadePacketDispatchDiffuse_100000);
+
+    BENCH(FrameBufferClear_1000);
+
+    // scene setup is not part of the measurement
+    SceneBench::getScene("rem");
+    SceneBench::getScene("mug");
+    BENCH(Scene_rem_FORWARD_2);
+    BENCH(Scene_rem_DEPTH_PREPASS_2);
+    BENCH(Scene_rem_VISIBILITY_BUFFER_2);
+    BENCH(Scene_mug_FORWARD_1);
+    BENCH(Scene_mug_DEPTH_PREPASS_1);
+    BENCH(Scene_mug_VISIBILITY_BUFFER_1);
+    BENCH(Scene_rem_DYNAMIC_SHADER_2);
+    BENCH(Scene_rem_NONE1_true_2);
+    BENCH(Scene_rem_MSAA4_true_2);
+    BENCH(Scene_rem_MSAA16_true_2);
+    BENCH(Scene_rem_SSAA4_false_2);
+    BENCH(Scene_rem_ZOOM30_1);
+    BENCH(Scene_rem_ZOOM2_2);
+    BENCH(Scene_rem_ZOOM400_4);
+    BENCH(Scene_rem_ORBIT_true_4);
+    BENCH(Scene_rem_ORBIT_false_4);
+
     std::string filename("../benchmark/results/" + GIT_BRANCH + "-" + GIT_HASH +
                          ".txt");
     BenchHelper::writeToFile(filename);
@@ -0,0 +1,459 @@
+#ifndef RASTERBENCH_H
+#define RASTERBENCH_H
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "rasterizer/EdgeFunction.hpp"
+#include "rasterizer/FrameBuffer.hpp"
+#include "rasterizer/RasterKernel.hpp"
+#include "rasterizer/ShadeKernel.hpp"
+#include "rasterizer/VertexKernel.hpp"
+#define ll long long
+namespace RasterBench {
+// deterministic pseudo random blocks, shared by the benches and the check
+inline float uniform(uint32_t& state, float lo, float hi) {
+    state = state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * float(state >> 8) / float(1u << 24);
+}
+inline Rasterizer::RasterBlock randomBlock(uint32_t& state) {
+    Rasterizer::RasterBlock block;
+    for (int k = 0; k < 3; k++) {
+        block.e[k] = uniform(state, -40.0f, 120.0f);
+        block.de[k] = uniform(state, -20.0f, 20.0f);
+        // coverage comes from the fixed point values, in 1/256 square
+        // pixels like a triangle snapped to 1/16 pixel
+        block.ie[k] = int32_t(std::lround(block.e[k] * 256.0f));
+        block.ide[k] = int32_t(std::lround(block.de[k] * 256.0f));
+        // w is negated by the geometry phase
+        block.inv_w[k] = 1.0f / uniform(state, -50.0f, -0.1f);
+    }
+    block.inv_area = 1.0f / uniform(state, 100.0f, 1000.0f);
+    block.lanes = 1 + int(uniform(state, 0.0f, 7.99f));
+    for (int l = 0; l < Rasterizer::RASTER_BLOCK_SIZE; l++) {
+        block.depth[l] = uniform(state, 0.0f, 1.0f) < 0.25f
+                             ? -std::numeric_limits<float>::infinity()
+                             : uniform(state, -50.0f, -0.1f);
+    }
+    return block;
+}
+inline bool closeEnough(float a, float b) {
+    return std::abs(a - b) <= 1e-4f * std::max(1.0f, std::abs(a));
+}
+// compare a simd kernel against the scalar reference, returns the number of
+// mismatching lanes
+inline ll compareKernel(void (*kernel)(Rasterizer::RasterBlock&),
+                        const std::string& name, ll n) {
+    uint32_t state = 12345;
+    ll mismatches = 0;
+    for (ll i = 0; i < n; i++) {
+        Rasterizer::RasterBlock input = randomBlock(state);
+        Rasterizer::RasterBlock ref = input, out = input;
+        Rasterizer::rasterizeBlockScalar(ref);
+        kernel(out);
+        for (int l = 0; l < Rasterizer::RASTER_BLOCK_SIZE; l++) {
+            bool ref_pass = ref.mask >> l & 1u, out_pass = out.mask >> l & 1u;
+            if (ref_pass != out_pass) {
+                mismatches++;
+                continue;
+            }
+            if (!ref_pass) {
+                mismatches += ref.depth[l] != out.depth[l];
+                continue;
+            }
+            bool same = closeEnough(ref.depth[l], out.depth[l]) &&
+                        closeEnough(ref.z[l], out.z[l]);
+            for (int k = 0; k < 3; k++) {
+                same = same && closeEnough(ref.bary[k][l], out.bary[k][l]) &&
+                       closeEnough(ref.persp[k][l], out.persp[k][l]);
+            }
+            mismatches += !same;
+        }
+    }
+    std::cout << "CHECK: " << name << " vs scalar, " << mismatches
+              << " mismatching lanes in " << n << " blocks\n";
+    return mismatches;
+}
+// the simd kernels must agree with the scalar fallback
+inline ll checkRasterKernels() {
+    ll mismatches = 0;
+#ifdef OPT_SSE
+    if (Rasterizer::cpuSupportsSSE41()) {
+        mismatches +=
+            compareKernel(Rasterizer::rasterizeBlockSSE, "SSE", 1000000);
+    }
+#endif
+#ifdef OPT_AVX2
+    if (Rasterizer::cpuSupportsAVX2()) {
+        mismatches +=
+            compareKernel(Rasterizer::rasterizeBlockAVX2, "AVX2", 1000000);
+    }
+#endif
+    return mismatches;
+}
+// random matrices and vertex streams of VERTEX_BLOCK_SIZE * blocks vertices
+inline Rasterizer::ModelTransform randomTransform(uint32_t& state) {
+    Rasterizer::ModelTransform transform;
+    for (Rasterizer::Mat4* mat : {&transform.model, &transform.view_model,
+                                  &transform.normal, &transform.mvp}) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                mat->m[r][c] = uniform(state, -4.0f, 4.0f);
+            }
+        }
+    }
+    return transform;
+}
+inline Rasterizer::VertexStreams randomStreams(uint32_t& state, int blocks) {
+    std::vector<Rasterizer::Vertex> vertices(Rasterizer::VERTEX_BLOCK_SIZE *
+                                             blocks);
+    for (auto& vertex : vertices) {
+        vertex.coord = Rasterizer::Vec3(uniform(state, -10.0f, 10.0f),
+                                        uniform(state, -10.0f, 10.0f),
+                                        uniform(state, -10.0f, 10.0f));
+        vertex.normal = Rasterizer::Vec3(uniform(state, -1.0f, 1.0f),
+                                         uniform(state, -1.0f, 1.0f),
+                                         uniform(state, -1.0f, 1.0f));
+    }
+    Rasterizer::VertexStreams streams;
+    streams.assign(vertices);
+    return streams;
+}
+inline Rasterizer::VertexBlock streamBlock(
+    const Rasterizer::VertexStreams& streams, int block) {
+    Rasterizer::VertexBlock out;
+    for (int c = 0; c < 3; c++) {
+        out.position[c] =
+            streams.position[c].data() + block * Rasterizer::VERTEX_BLOCK_SIZE;
+        out.normal[c] =
+            streams.normal[c].data() + block * Rasterizer::VERTEX_BLOCK_SIZE;
+    }
+    return out;
+}
+// compare a simd vertex kernel against the scalar reference, returns the
+// number of mismatching vertices
+inline ll compareVertexKernel(void (*kernel)(const Rasterizer::ModelTransform&,
+                                             Rasterizer::VertexBlock&),
+                              const std::string& name, ll n) {
+    uint32_t state = 12345;
+    ll mismatches = 0;
+    for (ll i = 0; i < n; i++) {
+        Rasterizer::ModelTransform transform = randomTransform(state);
+        Rasterizer::VertexStreams streams = randomStreams(state, 1);
+        Rasterizer::VertexBlock ref = streamBlock(streams, 0),
+                                out = streamBlock(streams, 0);
+        Rasterizer::transformVertexBlockScalar(transform, ref);
+        kernel(transform, out);
+        // the magnitudes are up to about 200, absolute error is what matters
+        auto close = [](float a, float b) { return std::abs(a - b) <= 1e-3f; };
+        for (int l = 0; l < Rasterizer::VERTEX_BLOCK_SIZE; l++) {
+            bool same = close(ref.clip[3][l], out.clip[3][l]);
+            for (int c = 0; c < 3; c++) {
+                same = same && close(ref.clip[c][l], out.clip[c][l]) &&
+                       close(ref.view_pos[c][l], out.view_pos[c][l]) &&
+                       close(ref.world_pos[c][l], out.world_pos[c][l]) &&
+                       close(ref.view_normal[c][l], out.view_normal[c][l]);
+            }
+            mismatches += !same;
+        }
+    }
+    std::cout << "CHECK: " << name << " vertex kernel vs scalar, "
+              << mismatches << " mismatching vertices in " << n
+              << " blocks\n";
+    return mismatches;
+}
+inline ll checkVertexKernels() {
+    ll mismatches = 0;
+#ifdef OPT_SSE
+    if (Rasterizer::cpuSupportsSSE41()) {
+        mismatches += compareVertexKernel(
+            Rasterizer::transformVertexBlockSSE, "SSE", 100000);
+    }
+#endif
+#ifdef OPT_AVX2
+    if (Rasterizer::cpuSupportsAVX2()) {
+        mismatches += compareVertexKernel(
+            Rasterizer::transformVertexBlockAVX2, "AVX2", 100000);
+    }
+#endif
+#ifdef OPT_NEON
+    mismatches += compareVertexKernel(Rasterizer::transformVertexBlockNeon,
+                                      "NEON", 100000);
+#endif
+    return mismatches;
+}
+// two lights above the random fragments, shared by the shade benches
+inline Rasterizer::Light* const* shadeLights() {
+    static Rasterizer::Light lights[2] = {
+        Rasterizer::Light(Rasterizer::Vec3(20, 20, 20),
+                          Rasterizer::Vec3(500, 500, 500)),
+        Rasterizer::Light(Rasterizer::Vec3(-20, 20, 0),
+                          Rasterizer::Vec3(300, 300, 300))};
+    static Rasterizer::Light* pointers[2] = {&lights[0], &lights[1]};
+    return pointers;
+}
+inline Rasterizer::BlinnPhongPacket randomShadePacket(uint32_t& state) {
+    Rasterizer::BlinnPhongPacket packet;
+    for (int l = 0; l < Rasterizer::SHADE_PACKET_SIZE; l++) {
+        Rasterizer::Vec3 normal =
+            Rasterizer::Vec3(uniform(state, -1.0f, 1.0f),
+                             uniform(state, -1.0f, 1.0f),
+                             uniform(state, 0.1f, 1.0f))
+                .normalized();
+        packet.normal[0][l] = normal.x;
+        packet.normal[1][l] = normal.y;
+        packet.normal[2][l] = normal.z;
+        for (int c = 0; c < 3; c++) {
+            packet.position[c][l] = uniform(state, -5.0f, 5.0f);
+            packet.ka[c][l] = uniform(state, 0.0f, 1.0f);
+            packet.kd[c][l] = uniform(state, 0.0f, 1.0f);
+            packet.ks[c][l] = uniform(state, 0.0f, 1.0f);
+        }
+    }
+    packet.shininess = uniform(state, 1.0f, 200.0f);
+    packet.specular = true;
+    packet.ambient = uniform(state, 0.0f, 10.0f);
+    packet.eye_pos = Rasterizer::Vec3(uniform(state, -5.0f, 5.0f),
+                                      uniform(state, -5.0f, 5.0f), 10.0f);
+    packet.lights = shadeLights();
+    packet.light_count = 2;
+    return packet;
+}
+// compare a simd shade kernel against the scalar reference, returns the
+// number of mismatching lanes
+inline ll compareShadeKernel(void (*kernel)(Rasterizer::BlinnPhongPacket&),
+                             const std::string& name, ll n) {
+    uint32_t state = 12345;
+    ll mismatches = 0;
+    for (ll i = 0; i < n; i++) {
+        Rasterizer::BlinnPhongPacket ref = randomShadePacket(state);
+        // every other packet without highlights
+        ref.specular = (i & 1) == 0;
+        Rasterizer::BlinnPhongPacket out = ref;
+        Rasterizer::shadeBlinnPhongScalar(ref);
+        kernel(out);
+        // the colors are clamped to 1, absolute error is what matters
+        auto close = [](float a, float b) { return std::abs(a - b) <= 1e-3f; };
+        for (int l = 0; l < Rasterizer::SHADE_PACKET_SIZE; l++) {
+            bool same = true;
+            for (int c = 0; c < 3; c++) {
+                same = same && close(ref.color[c][l], out.color[c][l]);
+            }
+            mismatches += !same;
+        }
+    }
+    std::cout << "CHECK: " << name << " shade kernel vs scalar, " << mismatches
+              << " mismatching lanes in " << n << " packets\n";
+    return mismatches;
+}
+inline ll checkShadeKernels() {
+    ll mismatches = 0;
+#ifdef OPT_SSE
+    if (Rasterizer::cpuSupportsSSE41()) {
+        mismatches +=
+            compareShadeKernel(Rasterizer::shadeBlinnPhongSSE, "SSE", 100000);
+    }
+#endif
+#ifdef OPT_AVX2
+    if (Rasterizer::cpuSupportsAVX2()) {
+        mismatches += compareShadeKernel(Rasterizer::shadeBlinnPhongAVX2,
+                                         "AVX2", 100000);
+    }
+#endif
+#ifdef OPT_NEON
+    mismatches +=
+        compareShadeKernel(Rasterizer::shadeBlinnPhongNeon, "NEON", 100000);
+#endif
+    return mismatches;
+}
+// specularPow() over the range the shaders use, returns the number of
+// results off by more than 5e-5 relative, results that std::pow rounds to
+// a denormal may be flushed
+inline ll checkSpecularPow() {
+    ll errors = 0;
+    float max_error = 0.0f;
+    for (int j = 0; j <= 1000; j++) {
+        float n = float(j) * 0.5f;
+        for (int k = 0; k <= 10000; k++) {
+            float x = float(k) / 10000.0f;
+            float exact = std::pow(x, n), fast = Rasterizer::specularPow(x, n);
+            float error = std::abs(fast - exact);
+            if (exact >= std::numeric_limits<float>::min()) {
+                error /= exact;
+                max_error = std::max(max_error, error);
+            }
+            errors += error > 5e-5f;
+        }
+    }
+    std::cout << "CHECK: specular pow vs std::pow, " << errors
+              << " results off by more than 5e-5, max relative error "
+              << max_error << "\n";
+    return errors;
+}
+// fans of snapped triangles around a random point tile a square, every grid
+// position strictly inside it must be covered exactly once, returns the
+// number of positions that are not
+inline ll checkFillRule() {
+    constexpr int size = 128;
+    uint32_t state = 2468;
+    ll errors = 0;
+    std::vector<int> coverage(size * size);
+    for (int fan = 0; fan < 32; fan++) {
+        // the square outline, split at random points along its sides
+        std::vector<std::array<int32_t, 2>> outline;
+        const int32_t corners[4][2] = {
+            {0, 0}, {size, 0}, {size, size}, {0, size}};
+        for (int c = 0; c < 4; c++) {
+            const int32_t* p = corners[c];
+            const int32_t* q = corners[(c + 1) % 4];
+            outline.push_back({p[0], p[1]});
+            int32_t t = int32_t(uniform(state, 1.0f, float(size - 1)));
+            outline.push_back({p[0] + (q[0] - p[0]) * t / size,
+                               p[1] + (q[1] - p[1]) * t / size});
+        }
+        int32_t cx = int32_t(uniform(state, 1.0f, float(size - 1))),
+                cy = int32_t(uniform(state, 1.0f, float(size - 1)));
+        std::fill(coverage.begin(), coverage.end(), 0);
+        for (size_t i = 0; i < outline.size(); i++) {
+            const auto& p = outline[i];
+            const auto& q = outline[(i + 1) % outline.size()];
+            Rasterizer::FixedTriangleSetup setup({cx, p[0], q[0]},
+                                                 {cy, p[1], q[1]});
+            if (setup.degenerate()) {
+                continue;
+            }
+            for (int y = 1; y < size; y++) {
+                for (int x = 1; x < size; x++) {
+                    std::array<int64_t, 3> e = setup.evaluateBiased(x, y);
+                    coverage[y * size + x] += e[0] >= 0 && e[1] >= 0 &&
+                                              e[2] >= 0;
+                }
+            }
+        }
+        for (int y = 1; y < size; y++) {
+            for (int x = 1; x < size; x++) {
+                errors += coverage[y * size + x] != 1;
+            }
+        }
+    }
+    std::cout << "CHECK: fill rule, " << errors
+              << " positions not covered exactly once\n";
+    return errors;
+}
+// the trivial reject and accept of large triangles against the coverage of
+// every position of the rectangle
+inline ll checkRectCoverage() {
+    uint32_t state = 1357;
+    ll errors = 0;
+    for (int i = 0; i < 4096; i++) {
+        std::array<int32_t, 3> x, y;
+        for (int k = 0; k < 3; k++) {
+            x[k] = int32_t(uniform(state, -64.0f, 192.0f));
+            y[k] = int32_t(uniform(state, -64.0f, 192.0f));
+        }
+        Rasterizer::FixedTriangleSetup setup(x, y);
+        if (setup.degenerate()) {
+            continue;
+        }
+        int32_t x0 = int32_t(uniform(state, 0.0f, 112.0f)),
+                y0 = int32_t(uniform(state, 0.0f, 112.0f)),
+                x1 = x0 + int32_t(uniform(state, 0.0f, 16.0f)),
+                y1 = y0 + int32_t(uniform(state, 0.0f, 16.0f));
+        Rasterizer::RectCoverage coverage = setup.classify(x0, y0, x1, y1);
+        for (int32_t py = y0; py <= y1; py++) {
+            for (int32_t px = x0; px <= x1; px++) {
+                std::array<int64_t, 3> e = setup.evaluateBiased(px, py);
+                bool covered = e[0] >= 0 && e[1] >= 0 && e[2] >= 0;
+                errors += (coverage == Rasterizer::RectCoverage::OUTSIDE &&
+                           covered) ||
+                          (coverage == Rasterizer::RectCoverage::INSIDE &&
+                           !covered);
+            }
+        }
+    }
+    std::cout << "CHECK: rect coverage, " << errors
+              << " positions contradict the classification\n";
+    return errors;
+}
+}  // namespace RasterBench
+
+#define GEN_RASTERBLOCK(name, kernel, x)                              \
+    void RasterBlock##name##_##x() {                                  \
+        uint32_t state = 6789;                                        \
+        std::vector<Rasterizer::RasterBlock> blocks(1024);            \
+        for (auto& block : blocks) {                                  \
+            block = RasterBench::randomBlock(state);                  \
+        }                                                             \
+        unsigned covered = 0;                                         \
+        for (ll i = 0; i < x; i++) {                                  \
+            Rasterizer::RasterBlock block = blocks[i & 1023];         \
+            kernel(block);                                            \
+            covered += block.mask;                                    \
+        }                                                             \
+        std::cout << "covered checksum " << covered << std::endl;     \
+    }
+GEN_RASTERBLOCK(Scalar, Rasterizer::rasterizeBlockScalar, 10000000)
+GEN_RASTERBLOCK(Dispatch, Rasterizer::rasterizeBlock, 10000000)
+
+// transform x blocks, cycling through the vertices of 1024 blocks
+#define GEN_VERTEXBLOCK(name, kernel, x)                                    \
+    void VertexBlock##name##_##x() {                                        \
+        uint32_t state = 6789;                                              \
+        Rasterizer::ModelTransform transform =                              \
+            RasterBench::randomTransform(state);                            \
+        Rasterizer::VertexStreams streams =                                 \
+            RasterBench::randomStreams(state, 1024);                        \
+        float checksum = 0.0f;                                              \
+        for (ll i = 0; i < x; i++) {                                        \
+            Rasterizer::VertexBlock block =                                 \
+                RasterBench::streamBlock(streams, i & 1023);                \
+            kernel(transform, block);                                       \
+            checksum += block.clip[3][i & 7];                               \
+        }                                                                   \
+        std::cout << "clip w checksum " << checksum << std::endl;           \
+    }
+GEN_VERTEXBLOCK(Scalar, Rasterizer::transformVertexBlockScalar, 10000000)
+GEN_VERTEXBLOCK(Dispatch, Rasterizer::transformVertexBlock, 10000000)
+
+// light x full packets, cycling through 1024 random ones
+#define GEN_SHADEPACKET(name, kernel, highlights, x)                    \
+    void ShadePacket##name##_##x() {                                    \
+        uint32_t state = 6789;                                          \
+        std::vector<Rasterizer::BlinnPhongPacket> packets(1024);        \
+        for (auto& packet : packets) {                                  \
+            packet = RasterBench::randomShadePacket(state);             \
+            packet.specular = highlights;                               \
+        }                                                               \
+        float checksum = 0.0f;                                          \
+        for (ll i = 0; i < x; i++) {                                    \
+            Rasterizer::BlinnPhongPacket& packet = packets[i & 1023];   \
+            kernel(packet);                                             \
+            checksum += packet.color[0][i & 7];                         \
+        }                                                               \
+        std::cout << "red checksum " << checksum << std::endl;          \
+    }
+GEN_SHADEPACKET(Scalar, Rasterizer::shadeBlinnPhongScalar, true, 100000)
+GEN_SHADEPACKET(Dispatch, Rasterizer::shadeBlinnPhong, true, 100000)
+// a material without highlights
+GEN_SHADEPACKET(DispatchDiffuse, Rasterizer::shadeBlinnPhong, false, 100000)
+
+// clear an 800x800 4 sample framebuffer and touch one tile in a hundred
+#define GEN_FRAMEBUFFER_CLEAR(x)                                             \
+    void FrameBufferClear_##x() {                                            \
+        Rasterizer::FrameBuffer framebuffer(                                 \
+            800, 800, 4, Rasterizer::FrameBufferLayout::TILED);              \
+        for (ll i = 0; i < x; i++) {                                         \
+            framebuffer.clear();                                             \
+            for (int t = 0; t < framebuffer.tiles_x * framebuffer.tiles_y;   \
+                 t += 100) {                                                 \
+                framebuffer.prepareTile(t % framebuffer.tiles_x,             \
+                                        t / framebuffer.tiles_x);            \
+            }                                                                \
+        }                                                                    \
+    }
+GEN_FRAMEBUFFER_CLEAR(1000)
+
+#endif /* RASTERBENCH_H */
@@ -0,0 +1,256 @@
+#ifndef SCENEBENCH_H
+#define SCENEBENCH_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rasterizer/Scene.hpp"
+#include "rasterizer/scenes/SceneManager.hpp"
+#define ll long long
+namespace SceneBench {
+// scenes are set up once, so the benches only time clear() and render()
+inline Rasterizer::Scene* getScene(const std::string& name) {
+    static std::map<std::string, Rasterizer::Scene*> scenes;
+    Rasterizer::Scene*& scene = scenes[name];
+    if (scene == nullptr) {
+        scene = Rasterizer::SceneManager::getPredefinedSceneByName(name);
+    }
+    return scene;
+}
+inline void printRenderStats(const std::string& name,
+                             const Rasterizer::RenderStats& stats) {
+    std::cout << "RENDERSTATS: " << name << " clusters " << stats.clusters
+              << " frustum culled " << stats.frustum_culled
+              << " occlusion culled " << stats.occlusion_culled
+              << " phase one " << stats.phase_one << " phase two "
+              << stats.phase_two << " vertices " << stats.vertices
+              << " triangles " << stats.triangles
+              << " micro " << stats.raster_paths[0] << " normal "
+              << stats.raster_paths[1] << " large " << stats.raster_paths[2]
+              << " lods";
+    for (int level : stats.lod_levels) {
+        std::cout << " " << level;
+    }
+    std::cout << "\n";
+}
+inline void renderFrames(const std::string& name,
+                         const Rasterizer::RenderSettings& settings,
+                         ll frames) {
+    Rasterizer::Scene* scene = getScene(name);
+    scene->setRenderSettings(settings);
+    for (ll i = 0; i < frames; i++) {
+        scene->clear();
+        scene->render();
+    }
+    printRenderStats(name, scene->render_stats);
+}
+// orbit the camera around its center at half the distance, so clusters keep
+// becoming visible and hidden, the stats are summed over the frames, the lods
+// are the ones of the last frame
+inline void renderFramesOrbit(const std::string& name, bool occlusion,
+                              ll frames) {
+    Rasterizer::Scene* scene = getScene(name);
+    Rasterizer::Camera cam = scene->cam;
+    Rasterizer::RenderSettings settings;
+    settings.occlusion_culling = occlusion;
+    scene->setRenderSettings(settings);
+    Rasterizer::RenderStats total;
+    Rasterizer::Vec3 d = (cam.eye_pos - cam.center) * 0.5f;
+    for (ll i = 0; i < frames; i++) {
+        float a = 0.5f * float(i), c = std::cos(a), s = std::sin(a);
+        scene->cam.eye_pos =
+            cam.center +
+            Rasterizer::Vec3(d.x * c + d.z * s, d.y, d.z * c - d.x * s);
+        scene->clear();
+        scene->render();
+        const Rasterizer::RenderStats& stats = scene->render_stats;
+        total.clusters += stats.clusters;
+        total.frustum_culled += stats.frustum_culled;
+        total.occlusion_culled += stats.occlusion_culled;
+        total.phase_one += stats.phase_one;
+        total.phase_two += stats.phase_two;
+        total.vertices += stats.vertices;
+        total.triangles += stats.triangles;
+        for (int p = 0; p < 3; p++) {
+            total.raster_paths[p] += stats.raster_paths[p];
+        }
+        total.lod_levels = stats.lod_levels;
+    }
+    printRenderStats(name, total);
+    scene->cam = cam;
+}
+// move the camera towards its center like the scroll wheel does, zoom is the
+// remaining fraction of the distance, the camera is restored afterwards
+inline void renderFramesZoomed(const std::string& name, float zoom,
+                               ll frames) {
+    Rasterizer::Scene* scene = getScene(name);
+    Rasterizer::Camera cam = scene->cam;
+    scene->cam.eye_pos = cam.center + (cam.eye_pos - cam.center) * zoom;
+    renderFrames(name, Rasterizer::RenderSettings(), frames);
+    scene->cam = cam;
+}
+inline Rasterizer::RenderSettings makeSettings(Rasterizer::ShadingMode mode,
+                                               Rasterizer::AAMode aa_mode,
+                                               int samples, bool shadows) {
+    Rasterizer::RenderSettings settings;
+    settings.shading_mode = mode;
+    settings.aa_mode = aa_mode;
+    settings.samples = samples;
+    settings.shadows = shadows;
+    return settings;
+}
+// once the buffers of the frame have grown to size, rendering must not touch
+// the heap at all, allocations counts every operator new, returns the
+// allocations of the last of three frames summed over the shading modes
+inline ll checkFrameAllocations(const std::string& name,
+                                const std::atomic<ll>& allocations) {
+    Rasterizer::Scene* scene = getScene(name);
+    ll total = 0;
+    for (auto mode : {Rasterizer::ShadingMode::FORWARD,
+                      Rasterizer::ShadingMode::DEPTH_PREPASS,
+                      Rasterizer::ShadingMode::VISIBILITY_BUFFER}) {
+        scene->setRenderSettings(makeSettings(
+            mode, Rasterizer::AAMode::SSAA, 4, true));
+        for (int i = 0; i < 3; i++) {
+            ll before = allocations;
+            scene->clear();
+            scene->render();
+            if (i == 2) {
+                total += allocations - before;
+            }
+        }
+    }
+    std::cout << "CHECK: " << name << " frame allocations, " << total
+              << " in the third frame of every shading mode\n";
+    return total;
+}
+// render a frame and read it back the way dumpToPNG does
+inline std::vector<unsigned char> renderImage(
+    const std::string& name, const Rasterizer::RenderSettings& settings) {
+    Rasterizer::Scene* scene = getScene(name);
+    scene->setRenderSettings(settings);
+    scene->clear();
+    scene->render();
+    std::vector<unsigned char> image(scene->width * scene->height * 4);
+    scene->framebuffer.toRGBA8(image.data());
+    return image;
+}
+// the visibility buffer only defers shading, it must produce the very image
+// forward shading does, returns the number of differing channels
+inline ll checkVisibilityBuffer(const std::string& name,
+                                Rasterizer::AAMode aa_mode, int samples,
+                                bool shadows) {
+    std::vector<unsigned char> forward = renderImage(
+        name, makeSettings(Rasterizer::ShadingMode::FORWARD, aa_mode, samples,
+                           shadows));
+    std::vector<unsigned char> visibility = renderImage(
+        name, makeSettings(Rasterizer::ShadingMode::VISIBILITY_BUFFER,
+                           aa_mode, samples, shadows));
+    ll differing = 0;
+    for (size_t i = 0; i < forward.size(); i++) {
+        differing += forward[i] != visibility[i];
+    }
+    // spelled like the --aa argument
+    const char* aa_names[] = {"none", "ssaa", "msaa"};
+    std::cout << "CHECK: " << name << " visibility buffer vs forward, "
+              << aa_names[int(aa_mode)] << " " << samples
+              << (shadows ? " with" : " without") << " shadows, "
+              << differing << " channels differ\n";
+    return differing;
+}
+// the simd packet kernels approximate the specular pow, render a frame
+// with them and one with the scalar shader, which calls std::pow, and count
+// the color channels that are more than one level of 255 apart
+inline ll checkSpecularPowImage(const std::string& name) {
+    Rasterizer::Scene* scene = getScene(name);
+    Rasterizer::RenderSettings settings = makeSettings(
+        Rasterizer::ShadingMode::FORWARD, Rasterizer::AAMode::SSAA, 4, true);
+    std::vector<unsigned char> fast = renderImage(name, settings);
+    scene->setFragmentShader(
+        Rasterizer::Shader(Rasterizer::textureFragmentShader));
+    std::vector<unsigned char> exact = renderImage(name, settings);
+    scene->setFragmentShader(Rasterizer::TextureShader());
+    ll differing = 0;
+    int max_difference = 0;
+    for (size_t i = 0; i < fast.size(); i++) {
+        int d = std::abs(int(exact[i]) - int(fast[i]));
+        max_difference = std::max(max_difference, d);
+        differing += d > 1;
+    }
+    std::cout << "CHECK: " << name << " specular pow image vs std::pow, "
+              << differing << " channels off by more than 1/255, max "
+              << max_difference << "/255\n";
+    return differing;
+}
+// forward shading with the scene's texture shader called through
+// std::function instead of inlined into the raster loop
+inline void renderFramesDynamicShader(const std::string& name, ll frames) {
+    Rasterizer::Scene* scene = getScene(name);
+    scene->setFragmentShader(
+        Rasterizer::Shader(Rasterizer::textureFragmentShader));
+    renderFrames(name,
+                 makeSettings(Rasterizer::ShadingMode::FORWARD,
+                              Rasterizer::AAMode::SSAA, 4, true),
+                 frames);
+    scene->setFragmentShader(Rasterizer::TextureShader());
+}
+}  // namespace SceneBench
+
+// shading modes with the default settings
+#define GEN_SCENE(scene, mode, x)                                         \
+    void Scene_##scene##_##mode##_##x() {                                 \
+        SceneBench::renderFrames(                                         \
+            #scene,                                                       \
+            SceneBench::makeSettings(Rasterizer::ShadingMode::mode,       \
+                                     Rasterizer::AAMode::SSAA, 4, true),  \
+            x);                                                           \
+    }
+// forward shading with every aa setting, with and without shadows
+#define GEN_SCENE_AA(scene, aa, samples, shadows, x)                         \
+    void Scene_##scene##_##aa##samples##_##shadows##_##x() {                 \
+        SceneBench::renderFrames(                                            \
+            #scene,                                                          \
+            SceneBench::makeSettings(Rasterizer::ShadingMode::FORWARD,       \
+                                     Rasterizer::AAMode::aa, samples,        \
+                                     shadows),                               \
+            x);                                                              \
+    }
+// default settings with the camera close to or inside the model, triangles
+// cross the near plane and the guard band, or far away from it, where the
+// coarser lods are drawn
+#define GEN_SCENE_ZOOM(scene, percent, x)                                  \
+    void Scene_##scene##_ZOOM##percent##_##x() {                           \
+        SceneBench::renderFramesZoomed(#scene, float(percent) / 100.0f, x); \
+    }
+// the std::function shader slow path, compare with Scene_x_FORWARD_y
+#define GEN_SCENE_DYNAMIC_SHADER(scene, x)                        \
+    void Scene_##scene##_DYNAMIC_SHADER_##x() {                   \
+        SceneBench::renderFramesDynamicShader(#scene, x);         \
+    }
+// default settings while the camera orbits, with and without occlusion culling
+#define GEN_SCENE_ORBIT(scene, occlusion, x)                      \
+    void Scene_##scene##_ORBIT_##occlusion##_##x() {              \
+        SceneBench::renderFramesOrbit(#scene, occlusion, x);      \
+    }
+GEN_SCENE(rem, FORWARD, 2)
+GEN_SCENE(rem, DEPTH_PREPASS, 2)
+GEN_SCENE(rem, VISIBILITY_BUFFER, 2)
+GEN_SCENE(mug, FORWARD, 1)
+GEN_SCENE(mug, DEPTH_PREPASS, 1)
+GEN_SCENE(mug, VISIBILITY_BUFFER, 1)
+GEN_SCENE_DYNAMIC_SHADER(rem, 2)
+GEN_SCENE_AA(rem, NONE, 1, true, 2)
+GEN_SCENE_AA(rem, MSAA, 4, true, 2)
+GEN_SCENE_AA(rem, MSAA, 16, true, 2)
+GEN_SCENE_AA(rem, SSAA, 4, false, 2)
+GEN_SCENE_ZOOM(rem, 30, 1)
+GEN_SCENE_ZOOM(rem, 2, 2)
+GEN_SCENE_ZOOM(rem, 400, 4)
+GEN_SCENE_ORBIT(rem, true, 4)
+GEN_SCENE_ORBIT(rem, false, 4)
+
+#endif /* SCENEBENCH_H */
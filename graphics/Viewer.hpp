@@ -17,10 +17,12 @@ class Viewer {
     Rasterizer::Scene* scene;
     std::string name;
     Viewer() { platform_initialize(); }
-    void load(const std::string& scene_name) {
+    void load(const std::string& scene_name,
+              const Rasterizer::RenderSettings& settings) {
         name = scene_name;
 
-        scene = Rasterizer::SceneManager::getPredefinedSceneByName(scene_name);
+        scene = Rasterizer::SceneManager::getPredefinedSceneByName(scene_name,
+                                                                   settings);
     }
     void show() {
         unsigned long long frames_rendered = 0, time_cost = 0;
@@ -339,24 +339,10 @@ static void present_surface(window_t *window) {
 }
 
 static void blit_rgb(Rasterizer::Scene* scene, image_t *dst) {
-    int width = dst->width;
-    int height = dst->height;
-    int r, c;
-
     assert(scene->width == dst->width && scene->height == dst->height);
     assert(dst->format == FORMAT_LDR && dst->channels == 4);
 
-    for (r = 0; r < height; r++) {
-        for (c = 0; c < width; c++) {
-            int src_index = (r * width + c) * 4;
-            int dst_index = (r * width + c) * 4;
-            Rasterizer::RGBColor src_pixel = scene->pixels[r][c] * 255.f;
-            unsigned char *dst_pixel = &dst->ldr_buffer[dst_index];
-            dst_pixel[0] = src_pixel.x;  /* red */
-            dst_pixel[1] = src_pixel.y;  /* green */
-            dst_pixel[2] = src_pixel.z;  /* blue */
-        }
-    }
+    scene->framebuffer.toRGBA8(dst->ldr_buffer);
 }
 
 void window_draw_buffer(window_t *window,  Rasterizer::Scene* buffer) {
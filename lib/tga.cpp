@@ -1,4 +1,6 @@
 #include "lib/tga.hpp"
+#include <cstring>
+
 using namespace tga;
 template <typename Type>
 void TGA::RGBPaletted(Type* InBuffer, uint8_t* ColorMap, uint8_t* OutBuffer,
@@ -5,11 +5,12 @@ using namespace std;
 
 int main(int argc, char const* argv[]) {
     if (argc < 2) {
-        std::cerr << "no enough arguments\n";
+        std::cerr << "usage: " << argv[0] << " scene [render settings]\n";
+        printRenderSettingsUsage();
         exit(-1);
     }
     Viewer viewer;
-    viewer.load(argv[1]);
+    viewer.load(argv[1], parseRenderSettings(argc, argv, 2));
     viewer.show();
     return 0;
 }
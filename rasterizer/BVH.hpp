@@ -0,0 +1,231 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "rasterizer/BoundingVolume.hpp"
+#include "rasterizer/Mesh.hpp"
+namespace Rasterizer {
+// a triangle of a model, meshes[mesh]->vertex(level, triangle, k) are its
+// corners at the level the bvh was built for
+struct BVHPrimitive {
+    uint32_t mesh;
+    uint32_t triangle;
+};
+
+// nodes are stored depth first, the first child of an inner node directly
+// follows it
+struct BVHNode {
+    AABB bounds;
+    // inner nodes: index of the second child
+    // leaves: index of the first primitive
+    uint32_t offset = 0;
+    // primitives of a leaf, 0 for inner nodes
+    uint32_t count = 0;
+    bool leaf() const { return count > 0; }
+};
+
+// bounding volume hierarchy over the triangles of a model, built once at load
+// time with binned SAH, its leaves are clusters of a few dozen triangles that
+// are culled and submitted as a whole
+class BVH {
+   public:
+    // leaves are never split below the min size and always above the max
+    static constexpr uint32_t CLUSTER_MIN_SIZE = 8;
+    static constexpr uint32_t CLUSTER_MAX_SIZE = 64;
+    static constexpr int SAH_BINS = 16;
+    // cost of visiting a node relative to processing one triangle
+    static constexpr float SAH_TRAVERSAL_COST = 8.0f;
+
+    // node index and the planes its parent straddles
+    using TraversalStack = std::vector<std::pair<uint32_t, unsigned>>;
+
+    std::vector<BVHNode> nodes;
+    std::vector<BVHPrimitive> primitives;
+    uint32_t leaf_count = 0;
+
+    void build(const std::vector<Mesh*>& meshes, int level = 0) {
+        nodes.clear();
+        primitives.clear();
+        leaf_count = 0;
+        std::vector<BuildPrimitive> build_primitives;
+        for (uint32_t m = 0; m < meshes.size(); m++) {
+            const Mesh* mesh = meshes[m];
+            uint32_t triangles = mesh->levelIndices(level).size() / 3;
+            for (uint32_t t = 0; t < triangles; t++) {
+                BuildPrimitive primitive;
+                primitive.primitive = {m, t};
+                for (int k = 0; k < 3; k++) {
+                    primitive.bounds.expand(mesh->vertex(level, t, k).coord);
+                }
+                primitive.centroid = primitive.bounds.center();
+                build_primitives.push_back(primitive);
+            }
+        }
+        if (build_primitives.empty()) {
+            return;
+        }
+        nodes.reserve(2 * build_primitives.size() / CLUSTER_MIN_SIZE + 1);
+        buildNode(build_primitives, 0, build_primitives.size());
+        primitives.reserve(build_primitives.size());
+        for (const auto& primitive : build_primitives) {
+            primitives.push_back(primitive.primitive);
+        }
+    }
+    // visit(index, leaf) for every leaf intersecting the planes of frustum
+    // in planes, children nearer to eye are visited first, so the leaves
+    // come out roughly front to back
+    template <typename Visit>
+    void traverse(const Frustum& frustum, unsigned planes, const Vec3& eye,
+                  Visit&& visit) const {
+        TraversalStack stack;
+        traverse(frustum, planes, eye, std::forward<Visit>(visit), stack);
+    }
+    // same with a stack owned by the caller, which keeps its capacity
+    // across traversals
+    template <typename Visit>
+    void traverse(const Frustum& frustum, unsigned planes, const Vec3& eye,
+                  Visit&& visit, TraversalStack& stack) const {
+        stack.clear();
+        if (nodes.empty()) {
+            return;
+        }
+        stack.emplace_back(0u, planes);
+        while (!stack.empty()) {
+            auto [index, mask] = stack.back();
+            stack.pop_back();
+            const BVHNode& node = nodes[index];
+            if (!frustum.intersects(node.bounds, mask)) {
+                continue;
+            }
+            if (node.leaf()) {
+                visit(index, node);
+                continue;
+            }
+            uint32_t near = index + 1, far = node.offset;
+            if ((nodes[far].bounds.center() - eye).norm2() <
+                (nodes[near].bounds.center() - eye).norm2()) {
+                std::swap(near, far);
+            }
+            stack.emplace_back(far, mask);
+            stack.emplace_back(near, mask);
+        }
+    }
+
+   private:
+    struct BuildPrimitive {
+        BVHPrimitive primitive;
+        AABB bounds;
+        Vec3 centroid;
+    };
+    static float axis(const Vec3& v, int a) {
+        return a == 0 ? v.x : a == 1 ? v.y : v.z;
+    }
+    // builds the subtree over primitives [begin, end), returns its index
+    uint32_t buildNode(std::vector<BuildPrimitive>& primitives,
+                       uint32_t begin, uint32_t end) {
+        uint32_t index = nodes.size();
+        nodes.emplace_back();
+        AABB bounds, centroid_bounds;
+        for (uint32_t i = begin; i < end; i++) {
+            bounds.expand(primitives[i].bounds);
+            centroid_bounds.expand(primitives[i].centroid);
+        }
+        nodes[index].bounds = bounds;
+        uint32_t count = end - begin;
+        if (count <= CLUSTER_MIN_SIZE) {
+            return makeLeaf(index, begin, count);
+        }
+        Vec3 extent = centroid_bounds.extent();
+        int split_axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+                         : extent.y >= extent.z                        ? 1
+                                                                       : 2;
+        float lo = axis(centroid_bounds.min, split_axis),
+              width = axis(extent, split_axis);
+        // end until a split is chosen
+        uint32_t mid = end;
+        if (width > 0.0f) {
+            auto binOf = [&](const BuildPrimitive& primitive) {
+                float t = (axis(primitive.centroid, split_axis) - lo) / width;
+                return std::min(SAH_BINS - 1, int(t * SAH_BINS));
+            };
+            std::array<AABB, SAH_BINS> bin_bounds;
+            std::array<uint32_t, SAH_BINS> bin_counts{};
+            for (uint32_t i = begin; i < end; i++) {
+                int bin = binOf(primitives[i]);
+                bin_bounds[bin].expand(primitives[i].bounds);
+                bin_counts[bin]++;
+            }
+            // sweep from the right, then evaluate every split from the left
+            std::array<float, SAH_BINS> right_cost{};
+            AABB right;
+            uint32_t right_count = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                right.expand(bin_bounds[b]);
+                right_count += bin_counts[b];
+                if (right_count > 0) {
+                    right_cost[b] = right.area() * right_count;
+                }
+            }
+            AABB left;
+            uint32_t left_count = 0;
+            float best_cost = std::numeric_limits<float>::infinity();
+            int best_split = 0;
+            for (int b = 1; b < SAH_BINS; b++) {
+                left.expand(bin_bounds[b - 1]);
+                left_count += bin_counts[b - 1];
+                if (left_count == 0 || left_count == count) {
+                    continue;
+                }
+                float cost = left.area() * left_count + right_cost[b];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_split = b;
+                }
+            }
+            best_cost += SAH_TRAVERSAL_COST * bounds.area();
+            float leaf_cost = bounds.area() * count;
+            if (best_split > 0 &&
+                (best_cost < leaf_cost || count > CLUSTER_MAX_SIZE)) {
+                mid = std::partition(primitives.begin() + begin,
+                                     primitives.begin() + end,
+                                     [&](const BuildPrimitive& primitive) {
+                                         return binOf(primitive) < best_split;
+                                     }) -
+                      primitives.begin();
+            }
+        }
+        if (mid == end) {
+            if (count <= CLUSTER_MAX_SIZE) {
+                return makeLeaf(index, begin, count);
+            }
+            // too large for a cluster and no useful split, take the median
+            mid = begin + count / 2;
+            std::nth_element(primitives.begin() + begin,
+                             primitives.begin() + mid,
+                             primitives.begin() + end,
+                             [&](const BuildPrimitive& a,
+                                 const BuildPrimitive& b) {
+                                 return axis(a.centroid, split_axis) <
+                                        axis(b.centroid, split_axis);
+                             });
+        }
+        buildNode(primitives, begin, mid);
+        uint32_t second = buildNode(primitives, mid, end);
+        nodes[index].offset = second;
+        nodes[index].count = 0;
+        return index;
+    }
+    uint32_t makeLeaf(uint32_t index, uint32_t begin, uint32_t count) {
+        nodes[index].offset = begin;
+        nodes[index].count = count;
+        leaf_count++;
+        return index;
+    }
+};
+}  // namespace Rasterizer
+#endif /* BVH_HPP */
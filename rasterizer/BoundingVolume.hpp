@@ -0,0 +1,135 @@
+#ifndef BOUNDINGVOLUME_HPP
+#define BOUNDINGVOLUME_HPP
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "rasterizer/Math.hpp"
+namespace Rasterizer {
+// axis aligned bounding box, empty until a point is added
+struct AABB {
+    Vec3 min, max;
+    AABB()
+        : min{std::numeric_limits<float>::infinity()},
+          max{-std::numeric_limits<float>::infinity()} {}
+    AABB(const Vec3& min, const Vec3& max) : min{min}, max{max} {}
+    bool empty() const { return min.x > max.x; }
+    void expand(const Vec3& p) {
+        min = Vec3(std::min(min.x, p.x), std::min(min.y, p.y),
+                   std::min(min.z, p.z));
+        max = Vec3(std::max(max.x, p.x), std::max(max.y, p.y),
+                   std::max(max.z, p.z));
+    }
+    void expand(const AABB& box) {
+        if (!box.empty()) {
+            expand(box.min);
+            expand(box.max);
+        }
+    }
+    Vec3 center() const { return (min + max) * 0.5f; }
+    Vec3 extent() const { return max - min; }
+    // half the surface area, what the SAH compares
+    float area() const {
+        Vec3 e = extent();
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+struct BoundingSphere {
+    Vec3 center;
+    float radius = -1.0f;
+    bool empty() const { return radius < 0.0f; }
+};
+
+// the six planes of a view volume, a point p is inside if
+// dot(plane.xyz, p) + plane.w >= 0 for every plane
+// built from a model view projection matrix the planes live in model space,
+// so the bounds of a model are tested without transforming them
+struct Frustum {
+    // plane masks, the planes are left, right, bottom, top, near, far
+    static constexpr unsigned ALL_PLANES = 0x3fu;
+    static constexpr unsigned SIDE_PLANES = 0x0fu;
+    std::array<Vec4, 6> planes;
+    explicit Frustum(const Mat4& mvp) {
+        // clip space bounds -w <= x, y, z <= w are the rows of the matrix
+        // added to or subtracted from its last row
+        for (int r = 0; r < 3; r++) {
+            for (int s = 0; s < 2; s++) {
+                float sign = s == 0 ? 1.0f : -1.0f;
+                Vec4 plane(mvp.m[3][0] + sign * mvp.m[r][0],
+                           mvp.m[3][1] + sign * mvp.m[r][1],
+                           mvp.m[3][2] + sign * mvp.m[r][2],
+                           mvp.m[3][3] + sign * mvp.m[r][3]);
+                // normalized so sphere radii can be compared to distances
+                float norm = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                                       plane.z * plane.z);
+                if (norm > 0.0f) {
+                    plane = Vec4(plane.x / norm, plane.y / norm,
+                                 plane.z / norm, plane.w / norm);
+                }
+                planes[r * 2 + s] = plane;
+            }
+        }
+    }
+    static float distance(const Vec4& plane, const Vec3& p) {
+        return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+    }
+    // conservative, false only if the box is entirely outside one plane
+    bool intersects(const AABB& box) const {
+        if (box.empty()) {
+            return false;
+        }
+        for (const Vec4& plane : planes) {
+            // the corner farthest along the plane normal
+            Vec3 p(plane.x >= 0.0f ? box.max.x : box.min.x,
+                   plane.y >= 0.0f ? box.max.y : box.min.y,
+                   plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (distance(plane, p) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // hierarchical variant, only the planes in mask are tested, and the
+    // planes the box is entirely inside of are cleared from it, so the
+    // children of the box can skip them
+    bool intersects(const AABB& box, unsigned& mask) const {
+        if (box.empty()) {
+            return false;
+        }
+        for (int i = 0; i < 6; i++) {
+            if (!(mask >> i & 1u)) {
+                continue;
+            }
+            const Vec4& plane = planes[i];
+            Vec3 p(plane.x >= 0.0f ? box.max.x : box.min.x,
+                   plane.y >= 0.0f ? box.max.y : box.min.y,
+                   plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (distance(plane, p) < 0.0f) {
+                return false;
+            }
+            // the nearest corner is inside too
+            Vec3 n(plane.x >= 0.0f ? box.min.x : box.max.x,
+                   plane.y >= 0.0f ? box.min.y : box.max.y,
+                   plane.z >= 0.0f ? box.min.z : box.max.z);
+            if (distance(plane, n) >= 0.0f) {
+                mask &= ~(1u << i);
+            }
+        }
+        return true;
+    }
+    bool intersects(const BoundingSphere& sphere) const {
+        if (sphere.empty()) {
+            return false;
+        }
+        for (const Vec4& plane : planes) {
+            if (distance(plane, sphere.center) < -sphere.radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+}  // namespace Rasterizer
+#endif /* BOUNDINGVOLUME_HPP */
@@ -0,0 +1,141 @@
+#ifndef CLIPPER_HPP
+#define CLIPPER_HPP
+#include <array>
+
+#include "rasterizer/EdgeFunction.hpp"
+#include "rasterizer/Math.hpp"
+namespace Rasterizer {
+// vertices are only clipped against x and y once they leave the guard band,
+// which stays inside the fixed point range of the raster stage
+static constexpr float GUARD_BAND_LIMIT = SUBPIXEL_LIMIT / 2.0f;
+// a triangle clipped against the near plane and the four guard band planes
+// has at most 3 + 5 vertices
+static constexpr int MAX_CLIP_VERTICES = 8;
+
+// a vertex after the vertex stage, every attribute is linear in clip space,
+// so clipping interpolates all of them
+struct ClipVertex {
+    Vec4 clip;
+    Vec3 view_pos;
+    Vec3 world_pos;
+    // view space, normalized at setup
+    Vec3 normal;
+    Vec3 texture_coord;
+};
+
+// a convex polygon in clip space, the result of clipping one triangle
+struct ClipPolygon {
+    std::array<ClipVertex, MAX_CLIP_VERTICES> v;
+    int n = 0;
+};
+
+// planes of the clip space, a vertex is inside a plane if its distance is
+// non-negative, the outcode of a vertex has the bits of the planes it's
+// outside of
+enum ClipPlane : unsigned {
+    CLIP_NEAR = 1u << 0,
+    CLIP_FAR = 1u << 1,
+    CLIP_LEFT = 1u << 2,
+    CLIP_RIGHT = 1u << 3,
+    CLIP_BOTTOM = 1u << 4,
+    CLIP_TOP = 1u << 5,
+    GUARD_LEFT = 1u << 6,
+    GUARD_RIGHT = 1u << 7,
+    GUARD_BOTTOM = 1u << 8,
+    GUARD_TOP = 1u << 9,
+};
+static constexpr int CLIP_PLANE_COUNT = 10;
+static constexpr unsigned CLIP_FRUSTUM =
+    CLIP_NEAR | CLIP_FAR | CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP;
+// the planes triangles are actually clipped against, the rest of the frustum
+// is left to the scissor of the binner
+static constexpr unsigned CLIP_REQUIRED =
+    CLIP_NEAR | GUARD_LEFT | GUARD_RIGHT | GUARD_BOTTOM | GUARD_TOP;
+
+// homogeneous clipping of triangles before the perspective divide
+class Clipper {
+   public:
+    // guard band half extents in ndc
+    float guard_x, guard_y;
+    Clipper(int width, int height)
+        : guard_x{2.0f * GUARD_BAND_LIMIT / float(width) - 1.0f},
+          guard_y{2.0f * GUARD_BAND_LIMIT / float(height) - 1.0f} {}
+
+    float distance(const Vec4& c, int plane) const {
+        switch (plane) {
+            case 0:
+                return c.z + c.w;
+            case 1:
+                return c.w - c.z;
+            case 2:
+                return c.x + c.w;
+            case 3:
+                return c.w - c.x;
+            case 4:
+                return c.y + c.w;
+            case 5:
+                return c.w - c.y;
+            case 6:
+                return c.x + guard_x * c.w;
+            case 7:
+                return guard_x * c.w - c.x;
+            case 8:
+                return c.y + guard_y * c.w;
+            default:
+                return guard_y * c.w - c.y;
+        }
+    }
+    unsigned outcode(const Vec4& c) const {
+        unsigned code = 0;
+        for (int p = 0; p < CLIP_PLANE_COUNT; p++) {
+            // nan positions are outside of every plane
+            if (!(distance(c, p) >= 0.0f)) {
+                code |= 1u << p;
+            }
+        }
+        return code;
+    }
+    // clip the polygon against every plane in planes, Sutherland-Hodgman
+    void clip(ClipPolygon& polygon, unsigned planes) const {
+        for (int p = 0; p < CLIP_PLANE_COUNT && polygon.n > 0; p++) {
+            if (!(planes >> p & 1u)) {
+                continue;
+            }
+            ClipPolygon out;
+            for (int i = 0; i < polygon.n; i++) {
+                const ClipVertex& a = polygon.v[i];
+                const ClipVertex& b = polygon.v[(i + 1) % polygon.n];
+                float da = distance(a.clip, p), db = distance(b.clip, p);
+                if (da >= 0.0f) {
+                    out.v[out.n++] = a;
+                }
+                if ((da >= 0.0f) != (db >= 0.0f)) {
+                    // always interpolate from the inside vertex, so an edge
+                    // shared by two triangles is split at the same point
+                    out.v[out.n++] = da >= 0.0f ? intersect(a, b, da, db)
+                                                : intersect(b, a, db, da);
+                }
+            }
+            polygon = out;
+        }
+    }
+
+   private:
+    static ClipVertex intersect(const ClipVertex& in, const ClipVertex& out,
+                                float d_in, float d_out) {
+        float t = d_in / (d_in - d_out);
+        ClipVertex v;
+        v.clip = Vec4(in.clip.x + (out.clip.x - in.clip.x) * t,
+                      in.clip.y + (out.clip.y - in.clip.y) * t,
+                      in.clip.z + (out.clip.z - in.clip.z) * t,
+                      in.clip.w + (out.clip.w - in.clip.w) * t);
+        v.view_pos = in.view_pos + (out.view_pos - in.view_pos) * t;
+        v.world_pos = in.world_pos + (out.world_pos - in.world_pos) * t;
+        v.normal = in.normal + (out.normal - in.normal) * t;
+        v.texture_coord =
+            in.texture_coord + (out.texture_coord - in.texture_coord) * t;
+        return v;
+    }
+};
+}  // namespace Rasterizer
+#endif /* CLIPPER_HPP */
@@ -0,0 +1,164 @@
+#ifndef EDGEFUNCTION_HPP
+#define EDGEFUNCTION_HPP
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "rasterizer/Triangle.hpp"
+namespace Rasterizer {
+// vertices are snapped to 1/16 pixel, every supported sample position lies
+// on this grid, so coverage is decided exactly
+static constexpr int SUBPIXEL_BITS = 4;
+static constexpr int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+// snapped coordinates stay within +-2^14 pixels, which bounds the edge
+// coefficients by 2^19 and the steps inside a raster block far below 2^30
+static constexpr float SUBPIXEL_LIMIT = float(1 << 14);
+// edge values handed to the 32 bit raster kernels are clamped to +-2^30,
+// only their sign matters and no step inside a block can flip it
+static constexpr int64_t FIXED_EDGE_CLAMP = int64_t(1) << 30;
+
+inline int32_t snapToSubpixel(float v) {
+    return int32_t(std::lround(v * float(SUBPIXEL_SCALE)));
+}
+inline int32_t clampEdge(int64_t e) {
+    return int32_t(std::clamp(e, -FIXED_EDGE_CLAMP, FIXED_EDGE_CLAMP));
+}
+
+// where a rectangle of samples lies relative to a triangle
+enum class RectCoverage { OUTSIDE, PARTIAL, INSIDE };
+
+// integer edge functions of a triangle with snapped vertices, laid out like
+// TriangleSetup below with positions in 1/SUBPIXEL_SCALE pixels, so E_k is
+// exact
+// samples exactly on a shared edge belong to one triangle only, by the top
+// left rule: bias[k] is -1 unless edge k is a top or a left edge, and a
+// sample is covered if E_k + bias[k] >= 0 for every k
+struct FixedTriangleSetup {
+    std::array<int64_t, 3> a, b, x0, y0, bias;
+    // twice the area, 0 for degenerate triangles
+    int64_t area;
+    FixedTriangleSetup() : a{}, b{}, x0{}, y0{}, bias{}, area{0} {}
+    FixedTriangleSetup(const std::array<int32_t, 3>& x,
+                       const std::array<int32_t, 3>& y) {
+        for (int k = 0; k < 3; k++) {
+            int p = (k + 1) % 3, q = (k + 2) % 3;
+            a[k] = int64_t(y[p]) - y[q];
+            b[k] = int64_t(x[q]) - x[p];
+            x0[k] = x[p];
+            y0[k] = y[p];
+        }
+        area = evaluate(0, x[0], y[0]);
+        if (area < 0) {
+            for (int k = 0; k < 3; k++) {
+                a[k] = -a[k];
+                b[k] = -b[k];
+            }
+            area = -area;
+        }
+        // (a, b) points inside, y grows downwards, so a top edge has the
+        // interior below it and a left edge has it on its right
+        for (int k = 0; k < 3; k++) {
+            bool top_left = a[k] > 0 || (a[k] == 0 && b[k] > 0);
+            bias[k] = top_left ? 0 : -1;
+        }
+    }
+    bool degenerate() const { return area == 0; }
+    int64_t evaluate(int k, int64_t x, int64_t y) const {
+        return a[k] * (x - x0[k]) + b[k] * (y - y0[k]);
+    }
+    // biased edge values at the fixed point position (x, y)
+    std::array<int64_t, 3> evaluateBiased(int64_t x, int64_t y) const {
+        return {evaluate(0, x, y) + bias[0], evaluate(1, x, y) + bias[1],
+                evaluate(2, x, y) + bias[2]};
+    }
+    std::array<int64_t, 3> step(int64_t dx, int64_t dy) const {
+        return {a[0] * dx + b[0] * dy, a[1] * dx + b[1] * dy,
+                a[2] * dx + b[2] * dy};
+    }
+    // coverage of every fixed point position in [x0, x1] x [y0, y1], the
+    // edges are linear, so their range over the rectangle is reached at its
+    // corners
+    RectCoverage classify(int64_t x0, int64_t y0, int64_t x1,
+                          int64_t y1) const {
+        bool inside = true;
+        for (int k = 0; k < 3; k++) {
+            int64_t e = evaluate(k, x0, y0) + bias[k];
+            int64_t dx = a[k] * (x1 - x0), dy = b[k] * (y1 - y0);
+            if (e + std::max<int64_t>(dx, 0) + std::max<int64_t>(dy, 0) < 0) {
+                return RectCoverage::OUTSIDE;
+            }
+            inside &=
+                e + std::min<int64_t>(dx, 0) + std::min<int64_t>(dy, 0) >= 0;
+        }
+        return inside ? RectCoverage::INSIDE : RectCoverage::PARTIAL;
+    }
+};
+
+// per triangle setup of the three half-space edge functions
+// E_k(x, y) = a[k] * (x - x0[k]) + b[k] * (y - y0[k]) is the edge opposite to
+// vertex k, oriented so that the interior is non-negative, hence E_k is the
+// unnormalized barycentric coordinate of vertex k and E_k * inv_area the
+// normalized one
+// E_k is linear, stepping one pixel right adds a[k], one pixel down adds b[k]
+struct TriangleSetup {
+    std::array<float, 3> a, b;
+    // a point on each edge, evaluating relative to it keeps the precision of
+    // E_k near the edge independent of the screen position
+    std::array<float, 3> x0, y0;
+    // 1 / (2 * area), 0 for degenerate triangles
+    float inv_area;
+    TriangleSetup() : a{}, b{}, x0{}, y0{}, inv_area{0.0f} {}
+    explicit TriangleSetup(const Triangle& tri) {
+        for (int k = 0; k < 3; k++) {
+            const Vec3 &p = tri.v[(k + 1) % 3].coord,
+                       &q = tri.v[(k + 2) % 3].coord;
+            a[k] = p.y - q.y;
+            b[k] = q.x - p.x;
+            x0[k] = p.x;
+            y0[k] = p.y;
+        }
+        float area = evaluate(0, tri.v[0].coord.x, tri.v[0].coord.y);
+        // either winding is accepted, flip clockwise ones
+        if (area < 0.0f) {
+            for (int k = 0; k < 3; k++) {
+                a[k] = -a[k];
+                b[k] = -b[k];
+            }
+            area = -area;
+        }
+        inv_area = area > 0.0f ? 1.0f / area : 0.0f;
+    }
+    // the float counterpart of a snapped triangle, with the same orientation
+    explicit TriangleSetup(const FixedTriangleSetup& fixed) {
+        const float scale = 1.0f / float(SUBPIXEL_SCALE);
+        for (int k = 0; k < 3; k++) {
+            a[k] = float(fixed.a[k]) * scale;
+            b[k] = float(fixed.b[k]) * scale;
+            x0[k] = float(fixed.x0[k]) * scale;
+            y0[k] = float(fixed.y0[k]) * scale;
+        }
+        inv_area = fixed.degenerate()
+                       ? 0.0f
+                       : float(SUBPIXEL_SCALE * SUBPIXEL_SCALE) /
+                             float(fixed.area);
+    }
+    bool degenerate() const { return inv_area == 0.0f; }
+    float evaluate(int k, float x, float y) const {
+        return a[k] * (x - x0[k]) + b[k] * (y - y0[k]);
+    }
+    std::array<float, 3> evaluate(float x, float y) const {
+        return {evaluate(0, x, y), evaluate(1, x, y), evaluate(2, x, y)};
+    }
+    // offset of the edge values when moving by (dx, dy)
+    std::array<float, 3> step(float dx, float dy) const {
+        return {a[0] * dx + b[0] * dy, a[1] * dx + b[1] * dy,
+                a[2] * dx + b[2] * dy};
+    }
+    static bool inside(float e0, float e1, float e2) {
+        return e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f;
+    }
+};
+}  // namespace Rasterizer
+
+#endif /* EDGEFUNCTION_HPP */
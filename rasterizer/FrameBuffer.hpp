@@ -0,0 +1,406 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "rasterizer/HiZBuffer.hpp"
+#include "rasterizer/Math.hpp"
+namespace Rasterizer {
+// alignment of every framebuffer plane, one cache line
+static constexpr size_t FRAMEBUFFER_ALIGNMENT = 64;
+static constexpr int FRAMEBUFFER_ALIGNMENT_FLOATS =
+    FRAMEBUFFER_ALIGNMENT / sizeof(float);
+// tiled layout works on 8x8 pixel tiles
+static constexpr int FRAMEBUFFER_TILE_SHIFT = 3;
+static constexpr int FRAMEBUFFER_TILE_SIZE = 1 << FRAMEBUFFER_TILE_SHIFT;
+static constexpr int FRAMEBUFFER_TILE_MASK = FRAMEBUFFER_TILE_SIZE - 1;
+static constexpr int FRAMEBUFFER_TILE_PIXELS =
+    FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE;
+static_assert(FRAMEBUFFER_TILE_SIZE == HIZ_TILE_SIZE,
+              "hi-z tiles must match the framebuffer tiles");
+// spread the 3 low bits of a coordinate to the even bits of a morton code
+static constexpr uint8_t MORTON_SPREAD[FRAMEBUFFER_TILE_SIZE] = {
+    0b000000, 0b000001, 0b000100, 0b000101,
+    0b010000, 0b010001, 0b010100, 0b010101};
+
+enum class FrameBufferLayout {
+    // row major planes, sample s of (x, y) at s * plane_stride + y * pitch + x
+    LINEAR,
+    // 8x8 tiles in row major order, each tile stores all its samples
+    // back to back and the pixels inside a sample are morton ordered
+    TILED
+};
+
+// a single plane owning one cache line aligned allocation
+template <typename T>
+class AlignedBuffer {
+   public:
+    T* data;
+    size_t size;
+    AlignedBuffer() : data{nullptr}, size{0} {}
+    explicit AlignedBuffer(size_t size) : data{nullptr}, size{size} {
+        if (size == 0) {
+            return;
+        }
+        // aligned_alloc requires the size to be a multiple of the alignment
+        size_t bytes = size * sizeof(T);
+        bytes = (bytes + FRAMEBUFFER_ALIGNMENT - 1) / FRAMEBUFFER_ALIGNMENT *
+                FRAMEBUFFER_ALIGNMENT;
+        data =
+            static_cast<T*>(std::aligned_alloc(FRAMEBUFFER_ALIGNMENT, bytes));
+        if (!data) {
+            std::cerr << "framebuffer plane allocation failed" << std::endl;
+            exit(1);
+        }
+    }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+    AlignedBuffer(AlignedBuffer&& other) noexcept
+        : data{other.data}, size{other.size} {
+        other.data = nullptr;
+        other.size = 0;
+    }
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        return *this;
+    }
+    ~AlignedBuffer() { std::free(data); }
+    void fill(T value) { std::fill(data, data + size, value); }
+    T& operator[](size_t i) { return data[i]; }
+    T operator[](size_t i) const { return data[i]; }
+};
+using AlignedPlane = AlignedBuffer<float>;
+
+// no triangle covers the sample
+static constexpr uint32_t VISIBILITY_EMPTY = ~uint32_t(0);
+
+// structure-of-arrays framebuffer
+// every plane(depth, r, g, b) is a single aligned allocation holding all the
+// samples, in the linear layout each row of a sample is contiguous and SIMD
+// loadable, in the tiled layout a small triangle touches only a few cache
+// lines, pixels are detiled only when the image is written out
+// clearing is lazy, clear() only flags the 8x8 tiles and a tile is filled
+// when prepareTile() first touches it, tiles never touched are written out
+// as the clear color without reading the planes
+class FrameBuffer {
+   public:
+    int width;
+    int height;
+    int samples;
+    FrameBufferLayout layout;
+    // floats per row, padded so that every row starts on a cache line
+    int pitch;
+    // floats per sample plane
+    size_t plane_stride;
+    // tiles per row of the tiled layout, the clear flags use the same tiles
+    int tiles_x;
+    int tiles_y;
+
+    // per sample depth and color
+    AlignedPlane depth;
+    AlignedPlane sample_r, sample_g, sample_b;
+    // resolved pixel color
+    AlignedPlane pixel_r, pixel_g, pixel_b;
+    // visibility buffer, the visible triangle of every sample and the
+    // perspective correct barycentrics it is shaded with, only allocated by
+    // enableVisibility()
+    AlignedBuffer<uint32_t> sample_id;
+    AlignedPlane sample_alpha, sample_beta, sample_gamma;
+    // coarse farthest depth of the depth plane
+    HiZBuffer hiz;
+    // one byte per tile, set if the tile still has to be cleared, bytes
+    // rather than bits so that threads owning different tiles never share a
+    // flag word
+    std::vector<uint8_t> clear_pending;
+
+    FrameBuffer()
+        : width{0},
+          height{0},
+          samples{0},
+          layout{FrameBufferLayout::LINEAR},
+          pitch{0},
+          plane_stride{0},
+          tiles_x{0},
+          tiles_y{0} {}
+    FrameBuffer(int width, int height, int samples = 1,
+                FrameBufferLayout layout = FrameBufferLayout::LINEAR)
+        : width{width},
+          height{height},
+          samples{samples},
+          layout{layout},
+          // both paddings are multiples of the tile size, tiles never
+          // straddle the end of a plane
+          pitch{(width + FRAMEBUFFER_ALIGNMENT_FLOATS - 1) /
+                FRAMEBUFFER_ALIGNMENT_FLOATS * FRAMEBUFFER_ALIGNMENT_FLOATS},
+          plane_stride{size_t(pitch) *
+                       ((height + FRAMEBUFFER_TILE_MASK) &
+                        ~FRAMEBUFFER_TILE_MASK)},
+          tiles_x{pitch >> FRAMEBUFFER_TILE_SHIFT},
+          tiles_y{(height + FRAMEBUFFER_TILE_MASK) >> FRAMEBUFFER_TILE_SHIFT},
+          depth(plane_stride * samples),
+          pixel_r(plane_stride),
+          pixel_g(plane_stride),
+          pixel_b(plane_stride),
+          hiz(width, height),
+          clear_pending(size_t(tiles_x) * tiles_y) {
+        // single sampled buffers resolve straight into the pixel planes
+        if (samples > 1) {
+            sample_r = AlignedPlane(plane_stride * samples);
+            sample_g = AlignedPlane(plane_stride * samples);
+            sample_b = AlignedPlane(plane_stride * samples);
+        }
+        clear();
+    }
+
+    // index into the resolved pixel planes
+    size_t pixelIndex(int x, int y) const {
+        if (layout == FrameBufferLayout::TILED) {
+            return tileIndex(x, y) * FRAMEBUFFER_TILE_PIXELS +
+                   mortonIndex(x, y);
+        }
+        return size_t(y) * pitch + x;
+    }
+    // index into the per sample planes
+    size_t sampleIndex(int x, int y, int s) const {
+        if (layout == FrameBufferLayout::TILED) {
+            return (tileIndex(x, y) * samples + s) * FRAMEBUFFER_TILE_PIXELS +
+                   mortonIndex(x, y);
+        }
+        return s * plane_stride + size_t(y) * pitch + x;
+    }
+
+    float getDepth(int x, int y, int s = 0) const {
+        return depth[sampleIndex(x, y, s)];
+    }
+    void setDepth(int x, int y, int s, float z) {
+        depth[sampleIndex(x, y, s)] = z;
+    }
+    RGBColor getSampleColor(int x, int y, int s) const {
+        size_t i = sampleIndex(x, y, s);
+        return RGBColor(sample_r[i], sample_g[i], sample_b[i]);
+    }
+    void setSampleColor(int x, int y, int s, const RGBColor& color) {
+        size_t i = sampleIndex(x, y, s);
+        sample_r[i] = color.x;
+        sample_g[i] = color.y;
+        sample_b[i] = color.z;
+    }
+    RGBColor getPixel(int x, int y) const {
+        size_t i = pixelIndex(x, y);
+        return RGBColor(pixel_r[i], pixel_g[i], pixel_b[i]);
+    }
+    void setPixel(int x, int y, const RGBColor& color) {
+        size_t i = pixelIndex(x, y);
+        pixel_r[i] = color.x;
+        pixel_g[i] = color.y;
+        pixel_b[i] = color.z;
+    }
+
+    void clear() {
+        std::fill(clear_pending.begin(), clear_pending.end(), 1);
+        hiz.clear();
+    }
+    bool clearPending(int tx, int ty) const {
+        return clear_pending[size_t(ty) * tiles_x + tx];
+    }
+    // must be called before any sample or pixel of the tile (tx, ty) is
+    // accessed after a clear()
+    void prepareTile(int tx, int ty) {
+        uint8_t& pending = clear_pending[size_t(ty) * tiles_x + tx];
+        if (pending) {
+            clearTile(tx, ty);
+            pending = 0;
+        }
+    }
+    // resolve every pending clear, for writers that don't walk the tiles
+    void prepareAllTiles() {
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < tiles_x; tx++) {
+                prepareTile(tx, ty);
+            }
+        }
+    }
+
+    // allocate the visibility planes, they share the sample addressing
+    void enableVisibility() {
+        if (sample_id.size != 0) {
+            return;
+        }
+        sample_id = AlignedBuffer<uint32_t>(plane_stride * samples);
+        sample_alpha = AlignedPlane(plane_stride * samples);
+        sample_beta = AlignedPlane(plane_stride * samples);
+        sample_gamma = AlignedPlane(plane_stride * samples);
+        sample_id.fill(VISIBILITY_EMPTY);
+    }
+    uint32_t getVisibleId(int x, int y, int s) const {
+        return sample_id[sampleIndex(x, y, s)];
+    }
+    void setVisible(int x, int y, int s, uint32_t id,
+                    const std::array<float, 3>& bary) {
+        size_t i = sampleIndex(x, y, s);
+        sample_id[i] = id;
+        setVisibleBary(i, bary);
+    }
+    void setVisibleBary(size_t i, const std::array<float, 3>& bary) {
+        sample_alpha[i] = bary[0];
+        sample_beta[i] = bary[1];
+        sample_gamma[i] = bary[2];
+    }
+    std::array<float, 3> getVisibleBary(size_t i) const {
+        return {sample_alpha[i], sample_beta[i], sample_gamma[i]};
+    }
+
+    // recompute the farthest depth of the 8x8 tile (tx, ty) after its depth
+    // changed
+    void updateHiZTile(int tx, int ty) {
+        int x0 = tx * FRAMEBUFFER_TILE_SIZE, y0 = ty * FRAMEBUFFER_TILE_SIZE,
+            x1 = std::min(x0 + FRAMEBUFFER_TILE_SIZE, width),
+            y1 = std::min(y0 + FRAMEBUFFER_TILE_SIZE, height);
+        float farthest = std::numeric_limits<float>::infinity();
+        if (layout == FrameBufferLayout::TILED &&
+            x1 - x0 == FRAMEBUFFER_TILE_SIZE &&
+            y1 - y0 == FRAMEBUFFER_TILE_SIZE) {
+            // all samples of a full tile are contiguous
+            const float* tile = depth.data + sampleIndex(x0, y0, 0);
+            for (int i = 0; i < FRAMEBUFFER_TILE_PIXELS * samples; i++) {
+                farthest = std::min(farthest, tile[i]);
+            }
+        } else {
+            for (int s = 0; s < samples; s++) {
+                for (int y = y0; y < y1; y++) {
+                    for (int x = x0; x < x1; x++) {
+                        farthest = std::min(farthest, getDepth(x, y, s));
+                    }
+                }
+            }
+        }
+        hiz.setTile(tx, ty, farthest);
+    }
+
+    // write the resolved pixels as tightly packed rgba8, row by row
+    void toRGBA8(unsigned char* dst) const {
+        if (layout == FrameBufferLayout::TILED) {
+            detileRGBA8(dst);
+            return;
+        }
+        for (int y = 0; y < height; y++) {
+            const float *r = pixel_r.data + pixelIndex(0, y),
+                        *g = pixel_g.data + pixelIndex(0, y),
+                        *b = pixel_b.data + pixelIndex(0, y);
+            for (int x = 0; x < width; x++) {
+                if (clearPending(x >> FRAMEBUFFER_TILE_SHIFT,
+                                 y >> FRAMEBUFFER_TILE_SHIFT)) {
+                    *dst++ = 0;
+                    *dst++ = 0;
+                    *dst++ = 0;
+                } else {
+                    *dst++ = r[x] * 255.0f;
+                    *dst++ = g[x] * 255.0f;
+                    *dst++ = b[x] * 255.0f;
+                }
+                *dst++ = 255;
+            }
+        }
+    }
+
+   private:
+    size_t tileIndex(int x, int y) const {
+        return size_t(y >> FRAMEBUFFER_TILE_SHIFT) * tiles_x +
+               (x >> FRAMEBUFFER_TILE_SHIFT);
+    }
+    static int mortonIndex(int x, int y) {
+        return MORTON_SPREAD[x & FRAMEBUFFER_TILE_MASK] |
+               (MORTON_SPREAD[y & FRAMEBUFFER_TILE_MASK] << 1);
+    }
+    // fill every plane of a tile with the clear values
+    void clearTile(int tx, int ty) {
+        const float far = -std::numeric_limits<float>::infinity();
+        if (layout == FrameBufferLayout::TILED) {
+            // all samples of a tile are contiguous
+            size_t tile = size_t(ty) * tiles_x + tx;
+            size_t s0 = tile * samples * FRAMEBUFFER_TILE_PIXELS,
+                   s1 = s0 + samples * FRAMEBUFFER_TILE_PIXELS;
+            size_t p0 = tile * FRAMEBUFFER_TILE_PIXELS,
+                   p1 = p0 + FRAMEBUFFER_TILE_PIXELS;
+            std::fill(depth.data + s0, depth.data + s1, far);
+            if (samples > 1) {
+                std::fill(sample_r.data + s0, sample_r.data + s1, 0.0f);
+                std::fill(sample_g.data + s0, sample_g.data + s1, 0.0f);
+                std::fill(sample_b.data + s0, sample_b.data + s1, 0.0f);
+            }
+            if (sample_id.size != 0) {
+                std::fill(sample_id.data + s0, sample_id.data + s1,
+                          VISIBILITY_EMPTY);
+            }
+            std::fill(pixel_r.data + p0, pixel_r.data + p1, 0.0f);
+            std::fill(pixel_g.data + p0, pixel_g.data + p1, 0.0f);
+            std::fill(pixel_b.data + p0, pixel_b.data + p1, 0.0f);
+            return;
+        }
+        // one row of a tile per sample and plane, the padding covers the
+        // tiles on the right and bottom border
+        int x0 = tx * FRAMEBUFFER_TILE_SIZE, y0 = ty * FRAMEBUFFER_TILE_SIZE;
+        for (int y = y0; y < y0 + FRAMEBUFFER_TILE_SIZE; y++) {
+            size_t p0 = size_t(y) * pitch + x0,
+                   p1 = p0 + FRAMEBUFFER_TILE_SIZE;
+            for (int s = 0; s < samples; s++) {
+                size_t s0 = s * plane_stride + p0,
+                       s1 = s0 + FRAMEBUFFER_TILE_SIZE;
+                std::fill(depth.data + s0, depth.data + s1, far);
+                if (samples > 1) {
+                    std::fill(sample_r.data + s0, sample_r.data + s1, 0.0f);
+                    std::fill(sample_g.data + s0, sample_g.data + s1, 0.0f);
+                    std::fill(sample_b.data + s0, sample_b.data + s1, 0.0f);
+                }
+                if (sample_id.size != 0) {
+                    std::fill(sample_id.data + s0, sample_id.data + s1,
+                              VISIBILITY_EMPTY);
+                }
+            }
+            std::fill(pixel_r.data + p0, pixel_r.data + p1, 0.0f);
+            std::fill(pixel_g.data + p0, pixel_g.data + p1, 0.0f);
+            std::fill(pixel_b.data + p0, pixel_b.data + p1, 0.0f);
+        }
+    }
+    // walk tile by tile so that every tile is read sequentially
+    void detileRGBA8(unsigned char* dst) const {
+        for (int ty = 0; ty < height; ty += FRAMEBUFFER_TILE_SIZE) {
+            for (int tx = 0; tx < width; tx += FRAMEBUFFER_TILE_SIZE) {
+                size_t base = tileIndex(tx, ty) * FRAMEBUFFER_TILE_PIXELS;
+                int y_end = std::min(ty + FRAMEBUFFER_TILE_SIZE, height),
+                    x_end = std::min(tx + FRAMEBUFFER_TILE_SIZE, width);
+                bool pending = clearPending(tx >> FRAMEBUFFER_TILE_SHIFT,
+                                            ty >> FRAMEBUFFER_TILE_SHIFT);
+                for (int y = ty; y < y_end; y++) {
+                    unsigned char* row = dst + (size_t(y) * width + tx) * 4;
+                    if (pending) {
+                        // the clear color
+                        for (int x = tx; x < x_end; x++) {
+                            *row++ = 0;
+                            *row++ = 0;
+                            *row++ = 0;
+                            *row++ = 255;
+                        }
+                        continue;
+                    }
+                    for (int x = tx; x < x_end; x++) {
+                        size_t i = base + mortonIndex(x, y);
+                        *row++ = pixel_r[i] * 255.0f;
+                        *row++ = pixel_g[i] * 255.0f;
+                        *row++ = pixel_b[i] * 255.0f;
+                        *row++ = 255;
+                    }
+                }
+            }
+        }
+    }
+};
+}  // namespace Rasterizer
+
+#endif /* FRAMEBUFFER_HPP */
@@ -0,0 +1,85 @@
+#ifndef HIZBUFFER_HPP
+#define HIZBUFFER_HPP
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace Rasterizer {
+// the fine level matches the framebuffer tiles
+static constexpr int HIZ_TILE_SIZE = 8;
+static constexpr int HIZ_BLOCK_SIZE = 32;
+static constexpr int HIZ_TILES_PER_BLOCK = HIZ_BLOCK_SIZE / HIZ_TILE_SIZE;
+
+// two level hierarchy of the farthest depth stored in every 8x8 tile and
+// every 32x32 block, the depth test keeps the larger z, so a triangle whose
+// nearest z is not larger than the farthest z of a region can't touch it
+// values are conservative, they may lag behind the depth buffer but are
+// never farther than any sample they cover
+class HiZBuffer {
+   public:
+    int tiles_x, tiles_y;
+    int blocks_x, blocks_y;
+    std::vector<float> tile_depth;
+    std::vector<float> block_depth;
+    HiZBuffer() : tiles_x{0}, tiles_y{0}, blocks_x{0}, blocks_y{0} {}
+    HiZBuffer(int width, int height)
+        : tiles_x{(width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE},
+          tiles_y{(height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE},
+          blocks_x{(width + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE},
+          blocks_y{(height + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE},
+          tile_depth(size_t(tiles_x) * tiles_y),
+          block_depth(size_t(blocks_x) * blocks_y) {
+        clear();
+    }
+    void clear() {
+        std::fill(tile_depth.begin(), tile_depth.end(),
+                  -std::numeric_limits<float>::infinity());
+        std::fill(block_depth.begin(), block_depth.end(),
+                  -std::numeric_limits<float>::infinity());
+    }
+    float getTile(int tx, int ty) const {
+        return tile_depth[ty * tiles_x + tx];
+    }
+    float getBlock(int bx, int by) const {
+        return block_depth[by * blocks_x + bx];
+    }
+    // store the new farthest depth of a tile and refresh its block
+    void setTile(int tx, int ty, float z) {
+        float& tile = tile_depth[ty * tiles_x + tx];
+        // the farthest depth of a block can only move closer if the tile
+        // that held it did
+        bool refresh = z > tile;
+        tile = z;
+        if (!refresh) {
+            return;
+        }
+        int bx = tx / HIZ_TILES_PER_BLOCK, by = ty / HIZ_TILES_PER_BLOCK;
+        int tx0 = bx * HIZ_TILES_PER_BLOCK, ty0 = by * HIZ_TILES_PER_BLOCK,
+            tx1 = std::min(tx0 + HIZ_TILES_PER_BLOCK, tiles_x),
+            ty1 = std::min(ty0 + HIZ_TILES_PER_BLOCK, tiles_y);
+        float block = std::numeric_limits<float>::infinity();
+        for (int y = ty0; y < ty1; y++) {
+            for (int x = tx0; x < tx1; x++) {
+                block = std::min(block, tile_depth[y * tiles_x + x]);
+            }
+        }
+        block_depth[by * blocks_x + bx] = block;
+    }
+    // true if no sample in the pixel rectangle [x0, x1) x [y0, y1) can pass
+    // the depth test against a triangle whose nearest depth is z_max
+    bool occluded(int x0, int y0, int x1, int y1, float z_max) const {
+        int bx0 = x0 / HIZ_BLOCK_SIZE, by0 = y0 / HIZ_BLOCK_SIZE,
+            bx1 = (x1 - 1) / HIZ_BLOCK_SIZE, by1 = (y1 - 1) / HIZ_BLOCK_SIZE;
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                if (z_max > getBlock(bx, by)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+}  // namespace Rasterizer
+
+#endif /* HIZBUFFER_HPP */
@@ -109,9 +109,14 @@ struct Light {
         }
         return visibility * INV_NUM_SAMPLES;
     }
+    // world positions to shadow map uv and depth
+    Mat4 getShadowMatrix() const { return getCorrectionMatrix() * getVP(); }
     float computeVisibility(const Vec3& world_coord) const {
-        Vec3 coord = this->getCorrectionMatrix() * this->getVP() *
-                     world_coord.toVec4(1.0f);
+        return computeVisibility(world_coord, getShadowMatrix());
+    }
+    float computeVisibility(const Vec3& world_coord,
+                            const Mat4& shadow_matrix) const {
+        Vec3 coord = shadow_matrix * world_coord.toVec4(1.0f);
         return PCSSShadowMap(coord);
     }
 
@@ -5,6 +5,17 @@
 #include "rasterizer/Math.hpp"
 #include "rasterizer/Texture.hpp"
 namespace Rasterizer {
+// what a material needs from the fragment shader, the shaders are
+// instantiated once per combination of these bits
+static constexpr unsigned MATERIAL_KA_MAP = 1u << 0;
+static constexpr unsigned MATERIAL_KD_MAP = 1u << 1;
+static constexpr unsigned MATERIAL_KS_MAP = 1u << 2;
+// Ks isn't zero and illum asks for highlights
+static constexpr unsigned MATERIAL_SPECULAR = 1u << 3;
+// illum 0, the diffuse color without any lighting
+static constexpr unsigned MATERIAL_UNLIT = 1u << 4;
+static constexpr unsigned MATERIAL_FEATURE_COMBINATIONS = 1u << 5;
+
 struct Material {
     Material()
         : Ns{0.0f},
@@ -13,7 +24,23 @@ struct Material {
           illum{0},
           Ka_tex{nullptr},
           Kd_tex{nullptr},
-          Ks_tex{nullptr} {}
+          Ks_tex{nullptr},
+          features{0} {}
+    // call once the colors, illum and the maps are loaded
+    void computeFeatures() {
+        features = 0;
+        if (illum == 0) {
+            // only the diffuse color is used
+            features = MATERIAL_UNLIT | (Kd_tex ? MATERIAL_KD_MAP : 0);
+            return;
+        }
+        features |= Ka_tex ? MATERIAL_KA_MAP : 0;
+        features |= Kd_tex ? MATERIAL_KD_MAP : 0;
+        bool specular = illum != 1 && (Ks.x != 0 || Ks.y != 0 || Ks.z != 0);
+        if (specular) {
+            features |= MATERIAL_SPECULAR | (Ks_tex ? MATERIAL_KS_MAP : 0);
+        }
+    }
 
     // Material Name
     std::string name;
@@ -46,6 +73,8 @@ struct Material {
     RGBTexture* Ka_tex;
     RGBTexture* Kd_tex;
     RGBTexture* Ks_tex;
+    // MATERIAL_* bits, see computeFeatures()
+    unsigned features;
 };
 }  // namespace Rasterizer
 
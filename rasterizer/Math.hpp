@@ -3,16 +3,35 @@
 #include <array>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #define OPT_EN
 #ifdef OPT_EN
 #if __has_include(<arm_neon.h>)
 #define OPT_NEON
 #endif
+// the x86 kernels are built with their own target flags, everything else
+// stays at the baseline isa and picks a kernel at runtime
+#if __has_include(<immintrin.h>) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define OPT_SSE
+#define OPT_AVX2
+#endif
 #endif
 #define DEG2RAD(d) ((float(d)) / 180.0f * M_PI)
 #define EPSILON 0.001f
 namespace Rasterizer {
+#ifdef OPT_SSE
+// instruction sets of the cpu running the binary, safe to call before main
+inline bool cpuSupportsSSE41() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+inline bool cpuSupportsAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#endif
 
 // each color portion regularized to [0, 1]
 class Vec3;
@@ -271,7 +290,7 @@ inline T interpolate(const std::array<T, 3>& arr, float alpha, float beta,
                      float gamma) {
     return alpha * arr[0] + beta * arr[1] + gamma * arr[2];
 }
-static float rand_2to1(const Rasterizer::Vec3& uv) {
+inline float rand_2to1(const Rasterizer::Vec3& uv) {
     // 0 - 1
     constexpr float a = 12.9898, b = 78.233, c = 43758.5453;
     float dt = uv.x * a + uv.y * b, sn = std::fmod(dt, M_PI);
@@ -1,14 +1,100 @@
 #ifndef MESH_H
 #define MESH_H
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rasterizer/BoundingVolume.hpp"
 #include "rasterizer/Material.hpp"
+#include "rasterizer/MeshSimplifier.hpp"
 #include "rasterizer/Texture.hpp"
 #include "rasterizer/Triangle.hpp"
+#include "rasterizer/VertexKernel.hpp"
 namespace Rasterizer {
 struct Mesh {
-    std::vector<Triangle*> triangles;
+    // shared by the triangles of every level of detail
+    std::vector<Vertex> vertices;
+    // three per triangle
+    std::vector<uint32_t> indices;
     Material* material;
     std::string name;
+    // model space bounds of the vertices, see computeBounds()
+    AABB bounds;
+    BoundingSphere sphere;
+    // what the vertex stage reads, see buildStreams()
+    VertexStreams streams;
+    // coarser versions of the triangles, lods[0] is level 1, see buildLODs()
+    std::vector<MeshLOD> lods;
     Mesh() : material{nullptr} {}
+    // has to be called again whenever the triangles change
+    void buildLODs() { lods = MeshSimplifier(vertices, indices).buildChain(); }
+    // levels beyond the coarsest one fall back to it
+    const std::vector<uint32_t>& levelIndices(int level) const {
+        if (level == 0 || lods.empty()) {
+            return indices;
+        }
+        return lods[std::min<size_t>(level, lods.size()) - 1].indices;
+    }
+    float levelError(int level) const {
+        if (level == 0 || lods.empty()) {
+            return 0.0f;
+        }
+        return lods[std::min<size_t>(level, lods.size()) - 1].error;
+    }
+    // vertex k of triangle t of a level
+    const Vertex& vertex(int level, uint32_t t, int k) const {
+        return vertices[levelIndices(level)[3 * t + k]];
+    }
+    // has to be called again whenever the vertices change
+    void buildStreams() { streams.assign(vertices); }
+    // has to be called again whenever the vertices change
+    void computeBounds() {
+        bounds = AABB();
+        for (const Vertex& vertex : vertices) {
+            bounds.expand(vertex.coord);
+        }
+        sphere = BoundingSphere();
+        if (bounds.empty()) {
+            return;
+        }
+        // centered on the box, tighter than the box's own sphere
+        sphere.center = bounds.center();
+        float radius2 = 0.0f;
+        for (const Vertex& vertex : vertices) {
+            radius2 =
+                std::max(radius2, (vertex.coord - sphere.center).norm2());
+        }
+        sphere.radius = std::sqrt(radius2);
+    }
+};
+
+// builds the vertex and index buffers of a mesh from triangle corners,
+// identical corners share one vertex
+class MeshBuilder {
+   public:
+    explicit MeshBuilder(Mesh& mesh) : mesh{mesh} {
+        for (uint32_t v = 0; v < mesh.vertices.size(); v++) {
+            ids.emplace(vertexKey(mesh.vertices[v]), v);
+        }
+    }
+    void addTriangle(const std::array<Vertex, 3>& corners) {
+        for (const Vertex& corner : corners) {
+            auto [id, added] =
+                ids.emplace(vertexKey(corner), uint32_t(mesh.vertices.size()));
+            if (added) {
+                mesh.vertices.push_back(corner);
+            }
+            mesh.indices.push_back(id->second);
+        }
+    }
+
+   private:
+    Mesh& mesh;
+    std::unordered_map<std::array<uint32_t, 12>, uint32_t, BitsHash<12>> ids;
 };
 }  // namespace Rasterizer
 
@@ -0,0 +1,348 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rasterizer/Math.hpp"
+#include "rasterizer/Triangle.hpp"
+namespace Rasterizer {
+// a simplified version of a mesh, its indices refer to the vertices of the
+// full mesh
+struct MeshLOD {
+    std::vector<uint32_t> indices;
+    // model space distance the surface may deviate from the full mesh, the
+    // largest error of the collapses
+    float error = 0.0f;
+};
+
+// sum of squared distances to a set of weighted planes, as a symmetric 4x4
+// matrix, the quadric error metric of Garland and Heckbert
+struct Quadric {
+    // a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+    std::array<double, 10> q{};
+    // the plane a * x + b * y + c * z + d = 0 with a unit normal
+    static Quadric plane(double a, double b, double c, double d,
+                         double weight) {
+        Quadric quadric;
+        quadric.q = {a * a, a * b, a * c, a * d, b * b,
+                     b * c, b * d, c * c, c * d, d * d};
+        for (double& v : quadric.q) {
+            v *= weight;
+        }
+        return quadric;
+    }
+    void add(const Quadric& quadric) {
+        for (int i = 0; i < 10; i++) {
+            q[i] += quadric.q[i];
+        }
+    }
+    double evaluate(const Vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z +
+               2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z +
+               2.0 * q[6] * y + q[7] * z * z + 2.0 * q[8] * z + q[9];
+    }
+};
+
+// builds a chain of LODs of an indexed mesh by half edge collapses ordered by
+// the quadric error, a collapse moves a vertex onto one of its neighbors, so
+// the remaining vertices keep their exact attributes and every level shares
+// the vertices of the full mesh
+// vertices are welded by position, a position with several vertices lies on
+// a uv or normal seam, and it may only collapse along an edge every one of
+// its vertices shares, so seams keep their shape and no uv chart is
+// stretched over another
+class MeshSimplifier {
+   public:
+    // coarser levels built at most, each with about half the triangles of
+    // the one before
+    static constexpr int LOD_MAX_LEVELS = 4;
+    static constexpr double LOD_REDUCTION = 0.5;
+    // meshes with fewer triangles aren't simplified any further
+    static constexpr size_t LOD_MIN_TRIANGLES = 64;
+    // weight of the planes that keep borders and seams in place, relative to
+    // the planes of the triangles
+    static constexpr double BORDER_WEIGHT = 4.0;
+
+    MeshSimplifier(const std::vector<Vertex>& vertices,
+                   const std::vector<uint32_t>& indices) {
+        weld(vertices, indices);
+        computeQuadrics();
+    }
+    std::vector<MeshLOD> buildChain() {
+        std::vector<MeshLOD> lods;
+        for (uint32_t t = 0; t < indices.size(); t++) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = position_of[indices[t][k]],
+                         b = position_of[indices[t][(k + 1) % 3]];
+                pushCollapse(a, b);
+                pushCollapse(b, a);
+            }
+        }
+        size_t previous = live_triangles;
+        while (lods.size() < LOD_MAX_LEVELS &&
+               previous >= 2 * LOD_MIN_TRIANGLES) {
+            bool reached = collapseTo(size_t(previous * LOD_REDUCTION));
+            // not worth a level if the mesh barely got simpler
+            if (live_triangles > previous * 3 / 4) {
+                break;
+            }
+            lods.push_back(snapshot());
+            previous = live_triangles;
+            if (!reached) {
+                break;
+            }
+        }
+        return lods;
+    }
+
+   private:
+    struct Collapse {
+        float cost;
+        uint32_t from, to;
+        uint32_t from_version, to_version;
+        bool operator>(const Collapse& c) const { return cost > c.cost; }
+    };
+    // per vertex of the mesh, its welded position
+    std::vector<uint32_t> position_of;
+    // per position
+    std::vector<Vec3> positions;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<uint32_t>> position_triangles;
+    std::vector<uint32_t> versions;
+    std::vector<uint8_t> position_alive;
+    // per triangle, vertex indices
+    std::vector<std::array<uint32_t, 3>> indices;
+    std::vector<uint8_t> triangle_alive;
+    size_t live_triangles = 0;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>>
+        queue;
+    float max_error = 0.0f;
+
+    void weld(const std::vector<Vertex>& mesh_vertices,
+              const std::vector<uint32_t>& mesh_indices) {
+        std::unordered_map<std::array<uint32_t, 3>, uint32_t, BitsHash<3>>
+            position_ids;
+        position_of.resize(mesh_vertices.size());
+        for (size_t v = 0; v < mesh_vertices.size(); v++) {
+            const Vec3& coord = mesh_vertices[v].coord;
+            auto [p, new_position] = position_ids.emplace(
+                std::array<uint32_t, 3>{floatBits(coord.x), floatBits(coord.y),
+                                        floatBits(coord.z)},
+                positions.size());
+            if (new_position) {
+                positions.push_back(coord);
+            }
+            position_of[v] = p->second;
+        }
+        for (size_t i = 0; i + 2 < mesh_indices.size(); i += 3) {
+            std::array<uint32_t, 3> tri = {mesh_indices[i], mesh_indices[i + 1],
+                                           mesh_indices[i + 2]};
+            // degenerate triangles don't survive the first level anyway
+            uint32_t p0 = position_of[tri[0]], p1 = position_of[tri[1]],
+                     p2 = position_of[tri[2]];
+            if (p0 != p1 && p1 != p2 && p2 != p0) {
+                indices.push_back(tri);
+            }
+        }
+        quadrics.resize(positions.size());
+        position_triangles.resize(positions.size());
+        versions.assign(positions.size(), 0);
+        position_alive.assign(positions.size(), 1);
+        triangle_alive.assign(indices.size(), 1);
+        live_triangles = indices.size();
+        for (uint32_t t = 0; t < indices.size(); t++) {
+            for (uint32_t v : indices[t]) {
+                position_triangles[position_of[v]].push_back(t);
+            }
+        }
+    }
+    void computeQuadrics() {
+        // edges between vertices used by a single triangle are
+        // borders of the mesh or of a uv chart
+        std::unordered_map<uint64_t, int> edge_count;
+        auto edgeKey = [](uint32_t a, uint32_t b) {
+            return uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+        };
+        for (const auto& tri : indices) {
+            for (int k = 0; k < 3; k++) {
+                edge_count[edgeKey(tri[k], tri[(k + 1) % 3])]++;
+            }
+        }
+        for (const auto& tri : indices) {
+            const Vec3 &p0 = positions[position_of[tri[0]]],
+                       &p1 = positions[position_of[tri[1]]],
+                       &p2 = positions[position_of[tri[2]]];
+            Vec3 n = (p1 - p0).cross(p2 - p0);
+            float length = n.norm();
+            if (!(length > 0.0f)) {
+                continue;
+            }
+            n = n / length;
+            // unweighted, so the root of the sum bounds the distance to
+            // every plane a vertex has absorbed
+            Quadric face = Quadric::plane(n.x, n.y, n.z, -n.dot(p0), 1.0);
+            for (uint32_t v : tri) {
+                quadrics[position_of[v]].add(face);
+            }
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = tri[k], b = tri[(k + 1) % 3];
+                if (edge_count[edgeKey(a, b)] != 1) {
+                    continue;
+                }
+                // the plane through the edge perpendicular to the triangle
+                const Vec3 &pa = positions[position_of[a]],
+                           &pb = positions[position_of[b]];
+                Vec3 m = (pb - pa).cross(n);
+                float m_length = m.norm();
+                if (!(m_length > 0.0f)) {
+                    continue;
+                }
+                m = m / m_length;
+                Quadric border = Quadric::plane(m.x, m.y, m.z, -m.dot(pa),
+                                                BORDER_WEIGHT);
+                quadrics[position_of[a]].add(border);
+                quadrics[position_of[b]].add(border);
+            }
+        }
+    }
+    // root of the merged quadrics at the target
+    float collapseError(uint32_t from, uint32_t to) const {
+        double sum = quadrics[from].evaluate(positions[to]) +
+                     quadrics[to].evaluate(positions[to]);
+        return float(std::sqrt(std::max(0.0, sum)));
+    }
+    void pushCollapse(uint32_t from, uint32_t to) {
+        queue.push({collapseError(from, to), from, to, versions[from],
+                    versions[to]});
+    }
+    // returns false if the queue ran out before the target was reached
+    bool collapseTo(size_t target) {
+        while (live_triangles > target) {
+            if (queue.empty()) {
+                return false;
+            }
+            Collapse c = queue.top();
+            queue.pop();
+            if (!position_alive[c.from] || !position_alive[c.to] ||
+                versions[c.from] != c.from_version ||
+                versions[c.to] != c.to_version) {
+                continue;
+            }
+            if (collapse(c.from, c.to)) {
+                max_error = std::max(max_error, c.cost);
+            }
+        }
+        return true;
+    }
+    // moves the position from onto to if it keeps the mesh intact
+    bool collapse(uint32_t from, uint32_t to) {
+        // every vertex at from goes to the vertex at to it shares an edge
+        // with
+        std::vector<std::pair<uint32_t, uint32_t>> remap;
+        auto findRemap = [&](uint32_t v) -> int {
+            for (size_t i = 0; i < remap.size(); i++) {
+                if (remap[i].first == v) {
+                    return i;
+                }
+            }
+            return -1;
+        };
+        auto corner = [&](uint32_t t, uint32_t position) {
+            for (int k = 0; k < 3; k++) {
+                if (position_of[indices[t][k]] == position) {
+                    return k;
+                }
+            }
+            return -1;
+        };
+        const std::vector<uint32_t>& around = position_triangles[from];
+        for (uint32_t t : around) {
+            int j = triangle_alive[t] ? corner(t, to) : -1;
+            if (j < 0) {
+                continue;
+            }
+            uint32_t v = indices[t][corner(t, from)], u = indices[t][j];
+            int r = findRemap(v);
+            if (r < 0) {
+                remap.emplace_back(v, u);
+            } else if (remap[r].second != u) {
+                return false;
+            }
+        }
+        // the triangles that stay must have their vertex remapped
+        // and must not flip
+        for (uint32_t t : around) {
+            if (!triangle_alive[t] || corner(t, to) >= 0) {
+                continue;
+            }
+            int i = corner(t, from);
+            if (findRemap(indices[t][i]) < 0) {
+                return false;
+            }
+            std::array<Vec3, 3> p;
+            for (int k = 0; k < 3; k++) {
+                p[k] = positions[position_of[indices[t][k]]];
+            }
+            Vec3 before = (p[1] - p[0]).cross(p[2] - p[0]);
+            p[i] = positions[to];
+            Vec3 after = (p[1] - p[0]).cross(p[2] - p[0]);
+            if (!(before.dot(after) > 0.0f)) {
+                return false;
+            }
+        }
+        std::vector<uint32_t>& target = position_triangles[to];
+        for (uint32_t t : around) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            if (corner(t, to) >= 0) {
+                triangle_alive[t] = 0;
+                live_triangles--;
+                continue;
+            }
+            int i = corner(t, from);
+            indices[t][i] = remap[findRemap(indices[t][i])].second;
+            target.push_back(t);
+        }
+        target.erase(std::remove_if(target.begin(), target.end(),
+                                    [&](uint32_t t) {
+                                        return !triangle_alive[t];
+                                    }),
+                     target.end());
+        quadrics[to].add(quadrics[from]);
+        position_alive[from] = 0;
+        position_triangles[from].clear();
+        versions[to]++;
+        for (uint32_t t : target) {
+            for (uint32_t v : indices[t]) {
+                uint32_t w = position_of[v];
+                if (w != to) {
+                    pushCollapse(to, w);
+                    pushCollapse(w, to);
+                }
+            }
+        }
+        return true;
+    }
+    MeshLOD snapshot() const {
+        MeshLOD lod;
+        lod.error = max_error;
+        lod.indices.reserve(3 * live_triangles);
+        for (uint32_t t = 0; t < indices.size(); t++) {
+            if (triangle_alive[t]) {
+                lod.indices.insert(lod.indices.end(), indices[t].begin(),
+                                   indices[t].end());
+            }
+        }
+        return lod;
+    }
+};
+}  // namespace Rasterizer
+#endif /* MESHSIMPLIFIER_HPP */
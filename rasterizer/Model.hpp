@@ -1,18 +1,81 @@
 #ifndef MODEL_HPP
 #define MODEL_HPP
+#include <algorithm>
 #include <vector>
 
+#include "rasterizer/BVH.hpp"
+#include "rasterizer/BoundingVolume.hpp"
 #include "rasterizer/Material.hpp"
 #include "rasterizer/Math.hpp"
 #include "rasterizer/Mesh.hpp"
 #include "rasterizer/Texture.hpp"
 #include "rasterizer/Triangle.hpp"
 namespace Rasterizer {
+// the meshes of a model at one level of detail
+struct ModelLOD {
+    // largest error of the meshes at this level
+    float error = 0.0f;
+    BVH bvh;
+};
+
 class Model {
    public:
     std::vector<Mesh*> meshes;
     Mat4 transform;
+    // model space bounds of every mesh, see computeBounds()
+    AABB bounds;
+    BoundingSphere sphere;
+    // over the triangles of every mesh, see buildBVH()
+    BVH bvh;
+    // coarser levels over the lods of the meshes, lods[0] is level 1
+    std::vector<ModelLOD> lods;
     Model() : transform{Mat4::identity()} {}
+    // has to be called again whenever the meshes or their lods change
+    void buildBVH() {
+        bvh.build(meshes);
+        size_t levels = 0;
+        for (const Mesh* mesh : meshes) {
+            levels = std::max(levels, mesh->lods.size());
+        }
+        lods.resize(levels);
+        for (size_t l = 0; l < levels; l++) {
+            int level = l + 1;
+            lods[l].error = 0.0f;
+            for (const Mesh* mesh : meshes) {
+                lods[l].error =
+                    std::max(lods[l].error, mesh->levelError(level));
+            }
+            lods[l].bvh.build(meshes, level);
+        }
+    }
+    int levelCount() const { return lods.size() + 1; }
+    const BVH& levelBVH(int level) const {
+        return level == 0 ? bvh : lods[level - 1].bvh;
+    }
+    float levelError(int level) const {
+        return level == 0 ? 0.0f : lods[level - 1].error;
+    }
+    // union of the mesh bounds, which have to be computed first
+    void computeBounds() {
+        bounds = AABB();
+        for (const Mesh* mesh : meshes) {
+            bounds.expand(mesh->bounds);
+        }
+        sphere = BoundingSphere();
+        if (bounds.empty()) {
+            return;
+        }
+        sphere.center = bounds.center();
+        sphere.radius = 0.0f;
+        for (const Mesh* mesh : meshes) {
+            if (!mesh->sphere.empty()) {
+                sphere.radius = std::max(
+                    sphere.radius,
+                    (mesh->sphere.center - sphere.center).norm() +
+                        mesh->sphere.radius);
+            }
+        }
+    }
     Mat4 getModelMatrix() const { return transform; }
     void scale(float ratio) {
         Mat4 scale_mat;
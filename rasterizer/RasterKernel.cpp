@@ -0,0 +1,45 @@
+#include "rasterizer/RasterKernel.hpp"
+
+using namespace Rasterizer;
+void Rasterizer::rasterizeBlockScalar(RasterBlock& block) {
+    block.mask = 0;
+    for (int l = 0; l < block.lanes; l++) {
+        if (block.ie[0] + block.ide[0] * l < 0 ||
+            block.ie[1] + block.ide[1] * l < 0 ||
+            block.ie[2] + block.ide[2] * l < 0) {
+            continue;
+        }
+        float e0 = block.e[0] + block.de[0] * float(l),
+              e1 = block.e[1] + block.de[1] * float(l),
+              e2 = block.e[2] + block.de[2] * float(l);
+        float alpha = e0 * block.inv_area, beta = e1 * block.inv_area,
+              gamma = e2 * block.inv_area;
+        float pa = alpha * block.inv_w[0], pb = beta * block.inv_w[1],
+              pg = gamma * block.inv_w[2];
+        float Z = 1.0f / (pa + pb + pg);
+        if (!(Z > block.depth[l])) {
+            continue;
+        }
+        block.depth[l] = block.z[l] = Z;
+        block.bary[0][l] = alpha;
+        block.bary[1][l] = beta;
+        block.bary[2][l] = gamma;
+        block.persp[0][l] = pa * Z;
+        block.persp[1][l] = pb * Z;
+        block.persp[2][l] = pg * Z;
+        block.mask |= 1u << l;
+    }
+}
+
+void Rasterizer::rasterizeBlock(RasterBlock& block) {
+#ifdef OPT_SSE
+    // the widest kernel the cpu runs, picked on the first call
+    static void (*const kernel)(RasterBlock&) =
+        cpuSupportsAVX2()    ? rasterizeBlockAVX2
+        : cpuSupportsSSE41() ? rasterizeBlockSSE
+                             : rasterizeBlockScalar;
+    kernel(block);
+#else
+    rasterizeBlockScalar(block);
+#endif
+}
@@ -0,0 +1,50 @@
+#ifndef RASTERKERNEL_HPP
+#define RASTERKERNEL_HPP
+#include <cstdint>
+
+#include "rasterizer/Math.hpp"
+namespace Rasterizer {
+// samples processed by one kernel invocation, one AVX2 register
+static constexpr int RASTER_BLOCK_SIZE = 8;
+
+// a span of RASTER_BLOCK_SIZE horizontally adjacent samples of one triangle,
+// lane l sits l pixels right of lane 0
+struct RasterBlock {
+    // in: fixed point edge values of lane 0 with the fill rule bias, and
+    // their step from lane to lane, a lane is covered if all three are
+    // non-negative
+    int32_t ie[3];
+    int32_t ide[3];
+    // in: float edge values of lane 0 and their step, only interpolated
+    float e[3];
+    float de[3];
+    float inv_area;
+    // in: reciprocal of the per vertex w
+    float inv_w[3];
+    // in: number of valid lanes, the rest are never covered
+    int lanes;
+    // in: stored depth, out: stored depth after the depth test
+    alignas(32) float depth[RASTER_BLOCK_SIZE];
+    // out: interpolated depth
+    alignas(32) float z[RASTER_BLOCK_SIZE];
+    // out: screen space barycentrics
+    alignas(32) float bary[3][RASTER_BLOCK_SIZE];
+    // out: perspective correct barycentrics
+    alignas(32) float persp[3][RASTER_BLOCK_SIZE];
+    // out: bit l is set if lane l is covered and passed the depth test
+    unsigned mask;
+};
+
+// evaluate coverage, depth and barycentrics of a block and update the
+// depth of the lanes that pass, the outputs of failed lanes are undefined
+void rasterizeBlock(RasterBlock& block);
+// portable reference implementation
+void rasterizeBlockScalar(RasterBlock& block);
+#ifdef OPT_SSE
+void rasterizeBlockSSE(RasterBlock& block);
+#endif
+#ifdef OPT_AVX2
+void rasterizeBlockAVX2(RasterBlock& block);
+#endif
+}  // namespace Rasterizer
+#endif /* RASTERKERNEL_HPP */
@@ -0,0 +1,148 @@
+#ifndef RENDERSETTINGS_HPP
+#define RENDERSETTINGS_HPP
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "rasterizer/FrameBuffer.hpp"
+namespace Rasterizer {
+enum class AAMode {
+    // a single sample at the pixel center
+    NONE,
+    // shade every sample
+    SSAA,
+    // test coverage and depth per sample, shade once per pixel per triangle
+    MSAA
+};
+
+enum class ShadingMode {
+    // shade every sample that passes the depth test when it is rasterized
+    FORWARD,
+    // rasterize triangle ids and barycentrics only, then shade every
+    // visible sample exactly once
+    VISIBILITY_BUFFER,
+    // rasterize depth only, then rasterize again and shade the samples whose
+    // depth equals the stored one
+    DEPTH_PREPASS
+};
+
+// everything that picks a raster kernel or a framebuffer format, the scene
+// instantiates one kernel per sample count, aa mode and shadow switch
+struct RenderSettings {
+    // samples per pixel, 1, 2, 4, 8 or 16
+    int samples = 4;
+    AAMode aa_mode = AAMode::SSAA;
+    // shadow lookup of every light
+    bool shadows = true;
+    ShadingMode shading_mode = ShadingMode::FORWARD;
+    FrameBufferLayout layout = FrameBufferLayout::TILED;
+    // draw what was visible last frame first, then only the clusters that
+    // pass the hi-z test against it
+    bool occlusion_culling = true;
+    // largest screen space error in pixels a model's lod may have, 0 always
+    // draws the full meshes
+    float lod_error = 1.0f;
+    // write the depth texture of the first light to ./depth.png on setup
+    bool dump_depthmap = false;
+
+    static constexpr bool validSampleCount(int samples) {
+        return samples == 1 || samples == 2 || samples == 4 || samples == 8 ||
+               samples == 16;
+    }
+    // a single sample is never anti-aliased and no anti-aliasing means a
+    // single sample
+    RenderSettings normalized() const {
+        RenderSettings settings = *this;
+        if (settings.samples == 1 || settings.aa_mode == AAMode::NONE) {
+            settings.samples = 1;
+            settings.aa_mode = AAMode::NONE;
+        }
+        return settings;
+    }
+};
+
+inline void printRenderSettingsUsage() {
+    std::cerr << "render settings:\n"
+                 "  --samples 1|2|4|8|16\n"
+                 "  --aa none|ssaa|msaa\n"
+                 "  --shadows on|off\n"
+                 "  --shading forward|visibility|prepass\n"
+                 "  --layout linear|tiled\n"
+                 "  --occlusion on|off\n"
+                 "  --lod-error <pixels>\n"
+                 "  --dump-depthmap\n";
+}
+
+// parse the render settings in argv[first, argc), exit on bad arguments
+inline RenderSettings parseRenderSettings(int argc, char const* argv[],
+                                          int first) {
+    RenderSettings settings;
+    for (int i = first; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--dump-depthmap") {
+            settings.dump_depthmap = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value of " << arg << std::endl;
+            printRenderSettingsUsage();
+            exit(1);
+        }
+        std::string value(argv[++i]);
+        bool valid = true;
+        if (arg == "--samples") {
+            settings.samples = std::atoi(value.c_str());
+            valid = RenderSettings::validSampleCount(settings.samples);
+        } else if (arg == "--aa") {
+            if (value == "none") {
+                settings.aa_mode = AAMode::NONE;
+            } else if (value == "ssaa") {
+                settings.aa_mode = AAMode::SSAA;
+            } else if (value == "msaa") {
+                settings.aa_mode = AAMode::MSAA;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--shadows") {
+            settings.shadows = value == "on";
+            valid = value == "on" || value == "off";
+        } else if (arg == "--shading") {
+            if (value == "forward") {
+                settings.shading_mode = ShadingMode::FORWARD;
+            } else if (value == "visibility") {
+                settings.shading_mode = ShadingMode::VISIBILITY_BUFFER;
+            } else if (value == "prepass") {
+                settings.shading_mode = ShadingMode::DEPTH_PREPASS;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--layout") {
+            if (value == "linear") {
+                settings.layout = FrameBufferLayout::LINEAR;
+            } else if (value == "tiled") {
+                settings.layout = FrameBufferLayout::TILED;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--occlusion") {
+            settings.occlusion_culling = value == "on";
+            valid = value == "on" || value == "off";
+        } else if (arg == "--lod-error") {
+            settings.lod_error = std::atof(value.c_str());
+            valid = settings.lod_error >= 0.0f;
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            printRenderSettingsUsage();
+            exit(1);
+        }
+        if (!valid) {
+            std::cerr << "invalid value " << value << " of " << arg
+                      << std::endl;
+            printRenderSettingsUsage();
+            exit(1);
+        }
+    }
+    return settings.normalized();
+}
+}  // namespace Rasterizer
+#endif /* RENDERSETTINGS_HPP */
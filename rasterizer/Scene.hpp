@@ -8,30 +8,189 @@
 
 #include <cmath>
 #include <fstream>
+#include <algorithm>
 #include <functional>
 #include <limits>
+#include <type_traits>
 #include <vector>
 
 #include "lib/lodepng.h"
+#include "rasterizer/BoundingVolume.hpp"
 #include "rasterizer/Camera.hpp"
+#include "rasterizer/Clipper.hpp"
+#include "rasterizer/EdgeFunction.hpp"
+#include "rasterizer/FrameBuffer.hpp"
 #include "rasterizer/Light.hpp"
 #include "rasterizer/Math.hpp"
 #include "rasterizer/Model.hpp"
+#include "rasterizer/RasterKernel.hpp"
+#include "rasterizer/RenderSettings.hpp"
 #include "rasterizer/Shader.hpp"
 #include "rasterizer/Texture.hpp"
+#include "rasterizer/TileBinner.hpp"
 #include "rasterizer/Triangle.hpp"
-#define SSAA_ENABLE
-// #define DUMP_DEPTHMAP
-// #define MSAA_ENABLE
+#include "rasterizer/VertexKernel.hpp"
 
 namespace Rasterizer {
 
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-static constexpr int AA_SAMPLE_RATIO = 2;
-static constexpr int AA_SAMPLE_RATIO_SQR = (AA_SAMPLE_RATIO * AA_SAMPLE_RATIO);
-static constexpr float AA_SAMPLE_STEP = (1.f / float(AA_SAMPLE_RATIO));
-static constexpr float AA_SAMPLE_OFFSET = (0.5f / float(AA_SAMPLE_RATIO));
-#endif
+static_assert(RASTER_BLOCK_SIZE == FRAMEBUFFER_TILE_SIZE,
+              "a raster block spans one framebuffer tile row");
+static_assert(SHADE_PACKET_SIZE == RASTER_BLOCK_SIZE,
+              "the samples a raster block passes are shaded as one packet");
+static_assert(BIN_TILE_SIZE % FRAMEBUFFER_TILE_SIZE == 0,
+              "a framebuffer tile and its clear flag belong to one bin");
+
+// what a raster pass writes for the samples that pass the depth test
+enum class RasterPass { FORWARD, VISIBILITY, DEPTH_ONLY, DEPTH_EQUAL };
+
+// how draw() walks a triangle, picked from its screen size at setup
+// MICRO: its samples are tested one by one before anything is set up, most
+// of these triangles cover none
+// NORMAL: every 8x8 tile of the bounding box is rasterized span by span
+// LARGE: tiles outside an edge are skipped, and tiles inside every edge
+// skip the coverage test
+enum class RasterPath : uint8_t { MICRO, NORMAL, LARGE };
+// bounding boxes of at most this many pixels per side are micro
+static constexpr int MICRO_TRIANGLE_SIZE = 2;
+// bounding boxes of at least this many pixels are large
+static constexpr int LARGE_TRIANGLE_PIXELS = 4 * FRAMEBUFFER_TILE_PIXELS;
+
+// edge values at the corner of the first pixel of a span, in float and in
+// fixed point with the fill rule bias
+struct SpanEdges {
+    std::array<float, 3> e;
+    std::array<int64_t, 3> fixed;
+    // edge values of lane 0 of a block offset by a sample step
+    void load(const std::array<float, 3>& step,
+              const std::array<int64_t, 3>& fixed_step,
+              RasterBlock& block) const {
+        for (int k = 0; k < 3; k++) {
+            block.e[k] = e[k] + step[k];
+            block.ie[k] = clampEdge(fixed[k] + fixed_step[k]);
+        }
+    }
+};
+
+// a bvh leaf of models[model] that passed culling, its triangles go to
+// raster_triangles from offset on
+struct VisibleCluster {
+    uint32_t model;
+    uint32_t node;
+    uint32_t offset;
+};
+
+// a vertex block of a mesh a phase needs that wasn't transformed yet this
+// frame, its vertices start at first
+struct PendingBlock {
+    uint32_t model;
+    uint32_t mesh;
+    uint32_t first;
+};
+
+// what culling and lod selection did in the last frame
+struct RenderStats {
+    // bvh leaves of every model
+    size_t clusters = 0;
+    size_t frustum_culled = 0;
+    size_t occlusion_culled = 0;
+    // clusters drawn in the first and the second phase
+    size_t phase_one = 0;
+    size_t phase_two = 0;
+    // vertices transformed by the vertex stage
+    size_t vertices = 0;
+    // triangles sent to the raster stage, including the clipped ones
+    size_t triangles = 0;
+    // visible triangles per RasterPath
+    std::array<size_t, 3> raster_paths{};
+    // per model, the level of detail drawn
+    std::vector<int> lod_levels;
+    // zeroes the counters, lod_levels keeps its capacity
+    void reset() {
+        std::vector<int> levels = std::move(lod_levels);
+        *this = RenderStats();
+        lod_levels = std::move(levels);
+        lod_levels.clear();
+    }
+};
+
+// a triangle after the geometry phase, ready to be rasterized
+struct RasterTriangle {
+    // screen space vertices
+    Triangle triangle;
+    std::array<Vec3, 3> view_pos;
+    std::array<Vec3, 3> world_pos;
+    std::array<float, 3> ws;
+    // coverage is decided by the fixed point setup of the snapped vertices,
+    // the float one only interpolates
+    FixedTriangleSetup fixed;
+    TriangleSetup setup;
+    RasterPath path;
+    Material* material;
+    // false if culled
+    bool visible;
+};
+
+// pixels a shade queue resolves at most at once
+static constexpr int SHADE_QUEUE_RESOLVES = 8 * RASTER_BLOCK_SIZE;
+
+// fragments waiting to be shaded as one packet, filled across the spans and
+// triangles of a bin tile until the material changes or the packet is full,
+// the colors are written in lane order, so a later fragment of a pixel still
+// overwrites an earlier one
+struct ShadeQueue {
+    FragmentPacket packet;
+    float visibility[SHADE_PACKET_SIZE];
+    // target pixel of every lane and the samples its color goes to
+    std::array<int, SHADE_PACKET_SIZE> x;
+    std::array<int, SHADE_PACKET_SIZE> y;
+    std::array<unsigned, SHADE_PACKET_SIZE> samples;
+    int lanes = 0;
+    // aa only, pixels to resolve after the lanes are written
+    std::array<std::array<int, 2>, SHADE_QUEUE_RESOLVES> resolves;
+    int resolve_count = 0;
+};
+
+// compile time part of the render settings and the fragment shader, every
+// raster function is instantiated once per config
+template <int SAMPLES, AAMode AA, bool SHADOWS, typename SHADER>
+struct RasterConfig {
+    static_assert(RenderSettings::validSampleCount(SAMPLES),
+                  "unsupported sample count");
+    static_assert((SAMPLES == 1) == (AA == AAMode::NONE),
+                  "a single sample is never anti-aliased");
+    static constexpr int samples = SAMPLES;
+    static constexpr AAMode aa_mode = AA;
+    static constexpr bool shadows = SHADOWS;
+    // a FragmentShader type or DynamicShader
+    using shader = SHADER;
+    // offset of sample i from the pixel corner, square counts use an ordered
+    // grid and the others the standard d3d patterns
+    static std::array<float, 2> samplePosition(int i) {
+        if constexpr (SAMPLES == 2) {
+            constexpr float positions[2][2] = {{0.75f, 0.75f}, {0.25f, 0.25f}};
+            return {positions[i][0], positions[i][1]};
+        } else if constexpr (SAMPLES == 8) {
+            // in 1/16 pixel from the center
+            constexpr int positions[8][2] = {{1, -3}, {-1, 3}, {5, 1},
+                                             {-3, -5}, {-5, 5}, {-7, -1},
+                                             {3, 7},  {7, -7}};
+            return {float(8 + positions[i][0]) / 16.0f,
+                    float(8 + positions[i][1]) / 16.0f};
+        } else {
+            constexpr int ratio = SAMPLES == 1 ? 1 : SAMPLES == 4 ? 2 : 4;
+            return {(float(i % ratio) + 0.5f) / float(ratio),
+                    (float(i / ratio) + 0.5f) / float(ratio)};
+        }
+    }
+};
+
+// edge offsets of every sample of a config from the pixel corner
+template <typename Config>
+struct SampleSteps {
+    std::array<std::array<float, 3>, Config::samples> steps;
+    std::array<std::array<int64_t, 3>, Config::samples> fixed_steps;
+};
+
 class Scene {
    private:
     // if the triangle is backfaced
@@ -45,62 +204,81 @@ class Scene {
     Camera cam;
     int width;
     int height;
-    std::vector<std::vector<RGBColor>> pixels;
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-    std::vector<std::vector<std::array<float, AA_SAMPLE_RATIO_SQR>>>
-#else
-    std::vector<std::vector<float>>
-#endif
-        zbuffer;
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-    std::vector<std::vector<std::array<RGBColor, AA_SAMPLE_RATIO_SQR>>>
-        colorbuffer;
-#endif
+    FrameBuffer framebuffer;
+    // per frame geometry phase output and its screen tile bins
+    std::vector<RasterTriangle> raster_triangles;
+    // per model, its matrices this frame
+    std::vector<ModelTransform> model_transforms;
+    // per model, the level of detail drawn this frame
+    std::vector<int> model_lods;
+    // per model and bvh node of its lod, if the leaf passed the hi-z test at
+    // the end of the last frame
+    std::vector<std::vector<uint8_t>> cluster_visible;
+    // clusters in the frustum, split by their visibility last frame
+    std::vector<VisibleCluster> phase_one_clusters;
+    std::vector<VisibleCluster> occlusion_candidates;
+    // the candidates that passed the hi-z test
+    std::vector<VisibleCluster> phase_two_clusters;
+    RenderStats render_stats;
+    // reused by the cluster culling of every model
+    BVH::TraversalStack traversal_stack;
+    // vertex stage output, every vertex of a model's mesh has a slot from
+    // vertex_bases[model][mesh] on, the slots are transformed a block at a
+    // time and only valid if the frame of their block is the current one
+    std::vector<ClipVertex> transformed_vertices;
+    std::vector<unsigned> vertex_outcodes;
+    std::vector<uint32_t> block_frames;
+    std::vector<std::vector<uint32_t>> vertex_bases;
+    std::vector<PendingBlock> pending_blocks;
+    uint32_t frame = 0;
+    // per thread, triangles split off by clipping, appended to the others
+    std::vector<std::vector<RasterTriangle>> clipped_triangles;
+    TileBinner binner;
 
     std::vector<Model*> models;
     std::vector<Light*> lights;
+    // only called by the slow path, static shaders are called directly
     Shader fragment_shader;
+    // what the shaders of the current frame read, see updateUniforms()
+    ShaderUniforms uniforms;
+    RenderSettings settings;
+    // raster and shading passes specialized for the settings and the shader
+    using RenderPasses = void (Scene::*)();
+    using RenderPassSelector = RenderPasses (*)(const RenderSettings&);
+    RenderPassSelector select_render_passes =
+        &Scene::selectRenderPasses<DynamicShader>;
+    RenderPasses render_passes = select_render_passes(settings);
     Scene() = default;
 
     // defaultly, look from 0, 0, 5 along the negative z axis
-    Scene(int width, int height, Shader fragment_shader = normalFragmentShader)
+    // slow path, every sample calls fragment_shader through std::function
+    Scene(int width, int height, Shader fragment_shader = normalFragmentShader,
+          const RenderSettings& settings = RenderSettings())
         : width{width}, height{height}, fragment_shader{fragment_shader} {
-        pixels.resize(height);
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-        colorbuffer.resize(height);
-#endif
-        zbuffer.resize(height);
-        for (int i = 0; i < height; i++) {
-            pixels[i].resize(width);
-            zbuffer[i].resize(width);
-            std::fill(pixels[i].begin(), pixels[i].end(), RGBColor(0));
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-            colorbuffer[i].resize(width);
-            for (int j = 0; j < width; j++) {
-                std::fill(zbuffer[i][j].begin(), zbuffer[i][j].end(),
-                          -std::numeric_limits<float>::infinity());
-                std::fill(colorbuffer[i][j].begin(), colorbuffer[i][j].end(),
-                          RGBColor(0.0f));
-            }
-#else
-            std::fill(zbuffer[i].begin(), zbuffer[i].end(),
-                      -std::numeric_limits<float>::infinity());
-#endif
-        }
+        setRenderSettings(settings);
+    }
+    // the raster loop is specialized for the shader
+    template <typename S>
+    Scene(int width, int height, const FragmentShader<S>& fragment_shader,
+          const RenderSettings& settings = RenderSettings())
+        : width{width}, height{height} {
+        setFragmentShader(fragment_shader);
+        setRenderSettings(settings);
     }
     // setup scene, compute light depthmap
     void sceneSetup() {
         computeDepthTexture();
-        if (lights.size() >= 1) {
-#ifdef DUMP_DEPTHMAP
+        if (lights.size() >= 1 && settings.dump_depthmap) {
+            framebuffer.prepareAllTiles();
             for (int i = 0; i < height; i++) {
                 for (int j = 0; j < width; j++) {
-                    pixels[i][j] = Vec3(lights[0]->dt->getBilinear(
-                        float(j) / width, 1.f - float(i) / height));
+                    framebuffer.setPixel(
+                        j, i,
+                        Vec3(lights[0]->dt->getBilinear(
+                            float(j) / width, 1.f - float(i) / height)));
                 }
             }
             dumpToPNG("./depth.png");
-#endif
         }
     }
     void render() { rasterizeTriangles(); }
@@ -112,13 +290,21 @@ class Scene {
             for (const auto model : models) {
                 Mat4 mvp = mv * model->getModelMatrix();
                 Mat4 cmvp = light->getCorrectionMatrix() * mvp;
-                for (const auto mesh : model->meshes) {
-                    for (const auto triangle : mesh->triangles) {
-                        auto vertices = triangle->v;
+                // only clusters inside the sides of the light's ortho volume
+                // can reach the depth texture, near and far don't clip it
+                Vec3 light_pos(model->getModelMatrix().inverse() *
+                               light->position.toVec4(1.0f));
+                auto draw_cluster = [&](uint32_t, const BVHNode& leaf) {
+                    for (uint32_t p = leaf.offset;
+                         p < leaf.offset + leaf.count; p++) {
+                        const BVHPrimitive& primitive =
+                            model->bvh.primitives[p];
+                        const Mesh* mesh = model->meshes[primitive.mesh];
                         std::array<Vertex, 3> t_vertices;
                         for (int i = 0; i < 3; i++) {
                             t_vertices[i].coord =
-                                cmvp * vertices[i].coord.toVec4(1.0f);
+                                cmvp * mesh->vertex(0, primitive.triangle, i)
+                                           .coord.toVec4(1.0f);
                             t_vertices[i].coord.x = DEPTH_TEXTURE_RESOLUTION *
                                                     t_vertices[i].coord.x;
                             t_vertices[i].coord.y =
@@ -152,88 +338,568 @@ class Scene {
                                               t_vertices[2].coord.y)),
                                  0.0f),
                         };
-                        for (int y = bbox[0].y; y < bbox[1].y; y++) {
-                            for (int x = bbox[0].x; x < bbox[1].x; x++) {
-                                auto [alpha, beta, gamma] =
-                                    t_tri.computeBarycentric2D(float(x) + 0.5f,
-                                                               float(y) + 0.5f);
-                                float z = 1.f / (alpha / t_tri.v[0].coord.z +
-                                                 beta / t_tri.v[1].coord.z +
-                                                 gamma / t_tri.v[1].coord.z);
-                                light->dt->tex[y][x] =
-                                    std::max(z, light->dt->tex[y][x]);
+                        TriangleSetup setup(t_tri);
+                        if (setup.degenerate()) {
+                            continue;
+                        }
+                        int x_min = bbox[0].x, y_min = bbox[0].y;
+                        std::array<float, 3> e_row = setup.evaluate(
+                            float(x_min) + 0.5f, float(y_min) + 0.5f);
+                        for (int y = y_min; y < bbox[1].y; y++) {
+                            std::array<float, 3> e = e_row;
+                            for (int x = x_min; x < bbox[1].x; x++) {
+                                if (TriangleSetup::inside(e[0], e[1], e[2])) {
+                                    float alpha = e[0] * setup.inv_area,
+                                          beta = e[1] * setup.inv_area,
+                                          gamma = e[2] * setup.inv_area;
+                                    float z =
+                                        1.f / (alpha / t_tri.v[0].coord.z +
+                                               beta / t_tri.v[1].coord.z +
+                                               gamma / t_tri.v[2].coord.z);
+                                    light->dt->tex[y][x] =
+                                        std::max(z, light->dt->tex[y][x]);
+                                }
+                                e[0] += setup.a[0];
+                                e[1] += setup.a[1];
+                                e[2] += setup.a[2];
                             }
+                            e_row[0] += setup.b[0];
+                            e_row[1] += setup.b[1];
+                            e_row[2] += setup.b[2];
                         }
                     }
-                }
+                };
+                model->bvh.traverse(Frustum(mvp), Frustum::SIDE_PLANES,
+                                    light_pos, draw_cluster);
             }
         }
     }
-    void rasterizeTriangles() {
+    void rasterizeTriangles() { (this->*render_passes)(); }
+    template <typename Config>
+    void renderPasses() {
+        // the pass that writes depth, the shading modes differ in what else
+        // it writes and what follows it
+        RasterPass pass = RasterPass::FORWARD;
+        if (settings.shading_mode == ShadingMode::VISIBILITY_BUFFER) {
+            pass = RasterPass::VISIBILITY;
+        } else if (settings.shading_mode == ShadingMode::DEPTH_PREPASS) {
+            pass = RasterPass::DEPTH_ONLY;
+        }
+        updateUniforms();
+        // phase one draws what was visible last frame, phase two what passes
+        // the hi-z test against phase one
+        cullClusters();
+        raster_triangles.clear();
+        transformClusters(phase_one_clusters);
+        binTriangles(0);
+        rasterizeTiles<Config>(pass);
+        if (settings.occlusion_culling) {
+            size_t first = raster_triangles.size();
+            occlusionCull();
+            transformClusters(phase_two_clusters);
+            binTriangles(first);
+            rasterizeTiles<Config>(pass);
+            updateClusterVisibility();
+        }
+        render_stats.phase_one = phase_one_clusters.size();
+        render_stats.phase_two = phase_two_clusters.size();
+        render_stats.triangles = raster_triangles.size();
+        for (const RasterTriangle& rt : raster_triangles) {
+            if (rt.visible) {
+                render_stats.raster_paths[int(rt.path)]++;
+            }
+        }
+        if (settings.shading_mode == ShadingMode::VISIBILITY_BUFFER) {
+            shadeVisibilityBuffer<Config>();
+        } else if (settings.shading_mode == ShadingMode::DEPTH_PREPASS) {
+            binTriangles(0);
+            rasterizeTiles<Config>(RasterPass::DEPTH_EQUAL);
+        }
+    }
+    template <typename S, int SAMPLES, AAMode AA>
+    static RenderPasses selectRenderPasses(bool shadows) {
+        return shadows
+                   ? &Scene::renderPasses<RasterConfig<SAMPLES, AA, true, S>>
+                   : &Scene::renderPasses<RasterConfig<SAMPLES, AA, false, S>>;
+    }
+    template <typename S, int SAMPLES>
+    static RenderPasses selectRenderPasses(AAMode aa_mode, bool shadows) {
+        return aa_mode == AAMode::MSAA
+                   ? selectRenderPasses<S, SAMPLES, AAMode::MSAA>(shadows)
+                   : selectRenderPasses<S, SAMPLES, AAMode::SSAA>(shadows);
+    }
+    template <typename S>
+    static RenderPasses selectRenderPasses(const RenderSettings& settings) {
+        const bool shadows = settings.shadows;
+        switch (settings.samples) {
+            case 1:
+                return selectRenderPasses<S, 1, AAMode::NONE>(shadows);
+            case 2:
+                return selectRenderPasses<S, 2>(settings.aa_mode, shadows);
+            case 4:
+                return selectRenderPasses<S, 4>(settings.aa_mode, shadows);
+            case 8:
+                return selectRenderPasses<S, 8>(settings.aa_mode, shadows);
+            case 16:
+                return selectRenderPasses<S, 16>(settings.aa_mode, shadows);
+        }
+        std::cerr << "unsupported sample count " << settings.samples
+                  << std::endl;
+        exit(1);
+    }
+    // the vectors keep their capacity, so this only allocates when lights
+    // are added
+    void updateUniforms() {
+        uniforms.eye_pos = cam.eye_pos;
+        uniforms.lights.assign(lights.begin(), lights.end());
+        uniforms.shadow_matrices.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++) {
+            uniforms.shadow_matrices[i] = lights[i]->getShadowMatrix();
+        }
+    }
+    // cull every model's bvh against the view frustum before any vertex
+    // work, the clusters that were visible last frame go to phase one and
+    // the others wait for the hi-z test of phase two
+    // clusters come out roughly front to back and the binner keeps that
+    // order, which helps the depth test reject early
+    void cullClusters() {
         Mat4 proj_mat = cam.getProjectionMatrix();
         Mat4 view_mat = cam.getViewMatrix();
+        render_stats.reset();
+        model_transforms.resize(models.size());
+        model_lods.resize(models.size(), 0);
+        // every transformed vertex of the last frame is stale now
+        frame++;
+        vertex_bases.resize(models.size());
+        uint32_t vertex_count = 0;
+        for (size_t m = 0; m < models.size(); m++) {
+            vertex_bases[m].resize(models[m]->meshes.size());
+            for (size_t i = 0; i < models[m]->meshes.size(); i++) {
+                vertex_bases[m][i] = vertex_count;
+                // meshes start on a block boundary
+                vertex_count += (models[m]->meshes[i]->vertices.size() +
+                                 VERTEX_BLOCK_SIZE - 1) /
+                                VERTEX_BLOCK_SIZE * VERTEX_BLOCK_SIZE;
+            }
+        }
+        transformed_vertices.resize(vertex_count);
+        vertex_outcodes.resize(vertex_count);
+        block_frames.resize(vertex_count / VERTEX_BLOCK_SIZE, 0);
+        cluster_visible.resize(models.size());
+        phase_one_clusters.clear();
+        occlusion_candidates.clear();
+        phase_two_clusters.clear();
+        for (size_t m = 0; m < models.size(); m++) {
+            const Model* model = models[m];
+            ModelTransform& transform = model_transforms[m];
+            transform.model = model->getModelMatrix();
+            transform.view_model = view_mat * transform.model;
+            transform.normal = transform.view_model.inverse().transpose();
+            transform.mvp = proj_mat * view_mat * transform.model;
+            int level = selectLOD(*model, transform, proj_mat);
+            const BVH& bvh = model->levelBVH(level);
+            render_stats.clusters += bvh.leaf_count;
+            // everything counts as visible before the first frame and when
+            // the lod changes
+            std::vector<uint8_t>& visible = cluster_visible[m];
+            if (level != model_lods[m] || visible.size() != bvh.nodes.size()) {
+                visible.assign(bvh.nodes.size(), 1);
+            }
+            model_lods[m] = level;
+            Frustum frustum(transform.mvp);
+            if (!frustum.intersects(model->sphere)) {
+                continue;
+            }
+            Vec3 eye(transform.model.inverse() * cam.eye_pos.toVec4(1.0f));
+            bvh.traverse(
+                frustum, Frustum::ALL_PLANES, eye,
+                [&](uint32_t node, const BVHNode&) {
+                    VisibleCluster cluster{uint32_t(m), node, 0};
+                    if (!settings.occlusion_culling || visible[node]) {
+                        phase_one_clusters.push_back(cluster);
+                    } else {
+                        occlusion_candidates.push_back(cluster);
+                    }
+                },
+                traversal_stack);
+        }
+        render_stats.frustum_culled = render_stats.clusters -
+                                      phase_one_clusters.size() -
+                                      occlusion_candidates.size();
+        render_stats.lod_levels = model_lods;
+    }
+    // the coarsest level whose error projects to at most settings.lod_error
+    // pixels at the point of the model's bounding sphere nearest to the eye
+    int selectLOD(const Model& model, const ModelTransform& transform,
+                  const Mat4& proj_mat) const {
+        if (!(settings.lod_error > 0.0f) || model.sphere.empty()) {
+            return 0;
+        }
+        // the largest scale of the model matrix takes model space errors to
+        // world space
+        float scale = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            scale = std::max(scale, Vec3(transform.model.m[0][c],
+                                         transform.model.m[1][c],
+                                         transform.model.m[2][c])
+                                        .norm());
+        }
+        Vec3 center(transform.view_model * model.sphere.center.toVec4(1.0f));
+        float distance = center.norm() - model.sphere.radius * scale;
+        if (!(distance > cam.near)) {
+            return 0;
+        }
+        // pixels per world space unit at that distance
+        float pixels = 0.5f * height * proj_mat.m[1][1] / distance;
+        for (int level = model.levelCount() - 1; level > 0; level--) {
+            if (model.levelError(level) * scale * pixels <=
+                settings.lod_error) {
+                return level;
+            }
+        }
+        return 0;
+    }
+    // phase two, keep the candidates the hi-z buffer of phase one can't
+    // prove hidden
+    void occlusionCull() {
+        phase_two_clusters.clear();
+        for (const VisibleCluster& cluster : occlusion_candidates) {
+            if (clusterOccluded(cluster)) {
+                render_stats.occlusion_culled++;
+            } else {
+                phase_two_clusters.push_back(cluster);
+            }
+        }
+    }
+    // retest every drawn cluster against the final hi-z buffer, the ones
+    // hidden now are left for phase two next frame
+    void updateClusterVisibility() {
+        for (const auto* drawn : {&phase_one_clusters, &phase_two_clusters}) {
+            for (const VisibleCluster& cluster : *drawn) {
+                cluster_visible[cluster.model][cluster.node] =
+                    !clusterOccluded(cluster);
+            }
+        }
+        for (const VisibleCluster& cluster : occlusion_candidates) {
+            cluster_visible[cluster.model][cluster.node] = 0;
+        }
+    }
+    const BVH& clusterBVH(const VisibleCluster& cluster) const {
+        return models[cluster.model]->levelBVH(model_lods[cluster.model]);
+    }
+    // true if the hi-z buffer proves that no sample of the cluster's bounding
+    // box can pass the depth test
+    bool clusterOccluded(const VisibleCluster& cluster) const {
+        const AABB& box = clusterBVH(cluster).nodes[cluster.node].bounds;
+        const Mat4& mvp = model_transforms[cluster.model].mvp;
+        float x_min = std::numeric_limits<float>::infinity(), y_min = x_min,
+              w_min = x_min, x_max = -x_min, y_max = -x_min;
+        for (int c = 0; c < 8; c++) {
+            Vec4 clip = mvp * Vec4(c & 1 ? box.max.x : box.min.x,
+                                   c & 2 ? box.max.y : box.min.y,
+                                   c & 4 ? box.max.z : box.min.z, 1.0f);
+            // boxes reaching the near plane don't project to a rectangle
+            if (!(clip.z >= -clip.w)) {
+                return false;
+            }
+            float x = 0.5f * width * (clip.x / clip.w + 1.0f),
+                  y = 0.5f * height * (-clip.y / clip.w + 1.0f);
+            x_min = std::min(x_min, x);
+            x_max = std::max(x_max, x);
+            y_min = std::min(y_min, y);
+            y_max = std::max(y_max, y);
+            w_min = std::min(w_min, clip.w);
+        }
+        int x0 = std::max(0, int(std::floor(x_min))),
+            y0 = std::max(0, int(std::floor(y_min))),
+            x1 = std::min(width, int(std::ceil(x_max))),
+            y1 = std::min(height, int(std::ceil(y_max)));
+        if (x0 >= x1 || y0 >= y1) {
+            return true;
+        }
+        // depth is -w, the nearest point of the box has the smallest w
+        return framebuffer.hiz.occluded(x0, y0, x1, y1, -w_min);
+    }
+    // geometry phase, transform and clip the triangles of the clusters into
+    // screen space, after the triangles already in raster_triangles
+    void transformClusters(std::vector<VisibleCluster>& clusters) {
+        Clipper clipper(width, height);
+        transformVertices(clusters, clipper);
+        size_t tcnt = raster_triangles.size();
+        for (VisibleCluster& cluster : clusters) {
+            cluster.offset = tcnt;
+            tcnt += clusterBVH(cluster).nodes[cluster.node].count;
+        }
+        raster_triangles.resize(tcnt);
+        int threads = 1;
+#ifdef OMP_ENABLE
+        threads = omp_get_max_threads();
+#endif
+        clipped_triangles.resize(threads);
+        for (auto& triangles : clipped_triangles) {
+            triangles.clear();
+        }
+        int n = clusters.size();
+#ifdef OMP_ENABLE
+#pragma omp parallel for schedule(static)
+#endif
+        for (int c = 0; c < n; c++) {
+            int thread = 0;
+#ifdef OMP_ENABLE
+            thread = omp_get_thread_num();
+#endif
+            const VisibleCluster& cluster = clusters[c];
+            const Model* model = models[cluster.model];
+            int level = model_lods[cluster.model];
+            const BVH& bvh = model->levelBVH(level);
+            const BVHNode& leaf = bvh.nodes[cluster.node];
+            for (uint32_t i = 0; i < leaf.count; i++) {
+                const BVHPrimitive& primitive =
+                    bvh.primitives[leaf.offset + i];
+                const Mesh* mesh = model->meshes[primitive.mesh];
+                const uint32_t* indices =
+                    &mesh->levelIndices(level)[3 * primitive.triangle];
+                uint32_t base = vertex_bases[cluster.model][primitive.mesh];
+                transformTriangle(
+                    {base + indices[0], base + indices[1], base + indices[2]},
+                    mesh->material, clipper,
+                    raster_triangles[cluster.offset + i],
+                    clipped_triangles[thread]);
+            }
+        }
+        // threads got ascending chunks, so the split triangles are appended
+        // in a deterministic order
+        for (const auto& triangles : clipped_triangles) {
+            raster_triangles.insert(raster_triangles.end(), triangles.begin(),
+                                    triangles.end());
+        }
+    }
+    // vertex stage, transform the blocks of every vertex the clusters use
+    // exactly once per frame, blocks shared with clusters of an earlier
+    // phase are already done
+    void transformVertices(const std::vector<VisibleCluster>& clusters,
+                           const Clipper& clipper) {
+        pending_blocks.clear();
+        for (const VisibleCluster& cluster : clusters) {
+            const Model* model = models[cluster.model];
+            int level = model_lods[cluster.model];
+            const BVH& bvh = model->levelBVH(level);
+            const BVHNode& leaf = bvh.nodes[cluster.node];
+            for (uint32_t i = 0; i < leaf.count; i++) {
+                const BVHPrimitive& primitive =
+                    bvh.primitives[leaf.offset + i];
+                const std::vector<uint32_t>& indices =
+                    model->meshes[primitive.mesh]->levelIndices(level);
+                uint32_t base = vertex_bases[cluster.model][primitive.mesh];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t vertex = indices[3 * primitive.triangle + k];
+                    uint32_t& block_frame =
+                        block_frames[(base + vertex) / VERTEX_BLOCK_SIZE];
+                    if (block_frame != frame) {
+                        block_frame = frame;
+                        pending_blocks.push_back(
+                            {cluster.model, primitive.mesh,
+                             vertex / VERTEX_BLOCK_SIZE * VERTEX_BLOCK_SIZE});
+                    }
+                }
+            }
+        }
+        int n = pending_blocks.size();
+        size_t vertices = 0;
+#ifdef OMP_ENABLE
+#pragma omp parallel for schedule(static) reduction(+ : vertices)
+#endif
+        for (int i = 0; i < n; i++) {
+            const PendingBlock& pending = pending_blocks[i];
+            const VertexStreams& streams =
+                models[pending.model]->meshes[pending.mesh]->streams;
+            VertexBlock block;
+            for (int c = 0; c < 3; c++) {
+                block.position[c] = streams.position[c].data() + pending.first;
+                block.normal[c] = streams.normal[c].data() + pending.first;
+            }
+            transformVertexBlock(model_transforms[pending.model], block);
+            // scatter the lanes to the vertices triangle setup reads
+            uint32_t slot = vertex_bases[pending.model][pending.mesh] +
+                            pending.first;
+            int lanes = std::min<size_t>(VERTEX_BLOCK_SIZE,
+                                         streams.count - pending.first);
+            for (int l = 0; l < lanes; l++) {
+                ClipVertex& out = transformed_vertices[slot + l];
+                out.clip = Vec4(block.clip[0][l], block.clip[1][l],
+                                block.clip[2][l], block.clip[3][l]);
+                out.view_pos = Vec3(block.view_pos[0][l],
+                                    block.view_pos[1][l],
+                                    block.view_pos[2][l]);
+                out.world_pos = Vec3(block.world_pos[0][l],
+                                     block.world_pos[1][l],
+                                     block.world_pos[2][l]);
+                out.normal = Vec3(block.view_normal[0][l],
+                                  block.view_normal[1][l],
+                                  block.view_normal[2][l]);
+                out.texture_coord =
+                    Vec3(streams.texture_coord[0][pending.first + l],
+                         streams.texture_coord[1][pending.first + l], 0.0f);
+                vertex_outcodes[slot + l] = clipper.outcode(out.clip);
+            }
+            vertices += lanes;
+        }
+        render_stats.vertices += vertices;
+    }
+    // clip one triangle of transformed vertices and set it up into rt, the
+    // pieces beyond the first one that clipping splits off go to clipped
+    void transformTriangle(const std::array<uint32_t, 3>& slots,
+                           Material* material, const Clipper& clipper,
+                           RasterTriangle& rt,
+                           std::vector<RasterTriangle>& clipped) const {
+        rt.visible = false;
+        ClipPolygon polygon;
+        polygon.n = 3;
+        unsigned all_out = ~0u, any_out = 0u;
+        for (int i = 0; i < 3; i++) {
+            polygon.v[i] = transformed_vertices[slots[i]];
+            unsigned code = vertex_outcodes[slots[i]];
+            all_out &= code;
+            any_out |= code;
+        }
+        // entirely outside of one frustum plane, this includes every triangle
+        // behind the camera
+        if (all_out & CLIP_FRUSTUM) {
+            return;
+        }
+        if (any_out & CLIP_REQUIRED) {
+            clipper.clip(polygon, any_out & CLIP_REQUIRED);
+        }
+        // the clipped polygon is convex, fan it out, the first triangle keeps
+        // the slot of the original one
+        for (int i = 1; i + 1 < polygon.n; i++) {
+            RasterTriangle& out = i == 1 ? rt : clipped.emplace_back();
+            setupTriangle({&polygon.v[0], &polygon.v[i], &polygon.v[i + 1]},
+                          material, out);
+        }
+    }
+    // perspective divide, viewport transform, snapping and setup of a
+    // clipped triangle, w is positive once the near plane is clipped
+    void setupTriangle(const std::array<const ClipVertex*, 3>& clipped,
+                       Material* material, RasterTriangle& rt) const {
         float f1 = (cam.far - cam.near) / 2.0f,
               f2 = (cam.far + cam.near) / 2.0f;
-
-        std::vector<Triangle> transformed_triangles;
-        int tcnt = 0;
-        for (const auto& model : models) {
-            Mat4 model_mat = model->getModelMatrix();
-            Mat4 norm_mat =
-                (cam.getViewMatrix() * model_mat).inverse().transpose();
-            Mat4 mvp = proj_mat * view_mat * model_mat;
-            for (const auto mesh : model->meshes) {
+        std::array<Vertex, 3>& t_vertices = rt.triangle.v;
+        std::array<int32_t, 3> snapped_x, snapped_y;
+        bool in_range = true;
+        for (int i = 0; i < 3; i++) {
+            const Vec4& clip = clipped[i]->clip;
+            rt.ws[i] = -clip.w;
+            Vec3 coord = Vec3(clip) / clip.w;
+            coord.x = 0.5 * width * (coord.x + 1.0);
+            coord.y = 0.5 * height * (-coord.y + 1.0);
+            coord.z = coord.z * f1 + f2;
+            // snap to the subpixel grid, the float position is kept in sync
+            // so both setups describe one triangle
+            if (std::abs(coord.x) < SUBPIXEL_LIMIT &&
+                std::abs(coord.y) < SUBPIXEL_LIMIT) {
+                snapped_x[i] = snapToSubpixel(coord.x);
+                snapped_y[i] = snapToSubpixel(coord.y);
+                coord.x = float(snapped_x[i]) / SUBPIXEL_SCALE;
+                coord.y = float(snapped_y[i]) / SUBPIXEL_SCALE;
+            } else {
+                in_range = false;
+            }
+            t_vertices[i].coord = coord;
+            t_vertices[i].normal = clipped[i]->normal.normalized();
+            t_vertices[i].texture_coord = clipped[i]->texture_coord;
+            t_vertices[i].color = RGBColor(148, 121, 92);
+            rt.view_pos[i] = clipped[i]->view_pos;
+            rt.world_pos[i] = clipped[i]->world_pos;
+        }
+        rt.material = material;
+        // the guard band keeps every vertex in the fixed point range, this
+        // only drops degenerate input like nan positions
+        rt.visible = in_range && !backfaceCulling(rt.triangle);
+        if (rt.visible) {
+            rt.fixed = FixedTriangleSetup(snapped_x, snapped_y);
+            rt.setup = TriangleSetup(rt.fixed);
+            rt.path = classifyTriangle(snapped_x, snapped_y);
+        }
+    }
+    static RasterPath classifyTriangle(const std::array<int32_t, 3>& x,
+                                       const std::array<int32_t, 3>& y) {
+        // pixels the bounding box touches
+        auto pixels = [](const std::array<int32_t, 3>& v) {
+            auto [lo, hi] = std::minmax({v[0], v[1], v[2]});
+            return (hi >> SUBPIXEL_BITS) - (lo >> SUBPIXEL_BITS) + 1;
+        };
+        int w = pixels(x), h = pixels(y);
+        if (w <= MICRO_TRIANGLE_SIZE && h <= MICRO_TRIANGLE_SIZE) {
+            return RasterPath::MICRO;
+        }
+        return w * h >= LARGE_TRIANGLE_PIXELS ? RasterPath::LARGE
+                                              : RasterPath::NORMAL;
+    }
+    // binning phase, sort the visible triangles from first on into screen
+    // tiles
+    void binTriangles(size_t first) {
+        int threads = 1;
 #ifdef OMP_ENABLE
-#pragma omp parallel for
+        threads = omp_get_max_threads();
 #endif
-                for (const auto triangle : mesh->triangles) {
-                    std::array<Vertex, 3>& vertices = triangle->v;
-                    std::array<Vertex, 3> t_vertices;
-                    std::array<Vec3, 3> view_pos;
-                    std::array<Vec3, 3> world_pos;
-                    std::array<float, 3> ws;
-                    for (int i = 0; i < 3; i++) {
-                        Vec4 transformed4(mvp * vertices[i].coord.toVec4(1.0f));
-                        Vec3 transformed(transformed4);
-                        transformed = transformed / transformed4.w;
-                        if (transformed4.w < 0) {
-                            transformed.x = -transformed.x;
-                            transformed.y = -transformed.y;
-                            ws[i] = transformed4.w;
-                        } else if (transformed4.w == 0) {
-                            break;
-                        } else {
-                            ws[i] = -transformed4.w;
-                        }
-
-                        t_vertices[i].coord = std::move(transformed);
-                        t_vertices[i].coord.x =
-                            0.5 * width * (t_vertices[i].coord.x + 1.0);
-                        t_vertices[i].coord.y =
-                            0.5 * height * (-t_vertices[i].coord.y + 1.0);
-                        t_vertices[i].coord.z = t_vertices[i].coord.z * f1 + f2;
-                        t_vertices[i].normal =
-                            Vec3(norm_mat * vertices[i].normal.toVec4(0.0f))
-                                .normalized();
-                        t_vertices[i].texture_coord = vertices[i].texture_coord;
-                        t_vertices[i].color = RGBColor(148, 121, 92);
-                        view_pos[i] = Vec3(view_mat * model_mat *
-                                           vertices[i].coord.toVec4(1.0f));
-                        world_pos[i] =
-                            Vec3(model_mat * vertices[i].coord.toVec4(1.0f));
-                    }
-                    // for each triangle, check if pixel is inside
-                    Triangle t_tri(t_vertices);
-                    if (!backfaceCulling(t_tri))
-                        this->draw(t_tri, view_pos, world_pos, mesh->material,
-                                   ws);
+        binner.reset(width, height, threads);
+        int n = raster_triangles.size();
+#ifdef OMP_ENABLE
+#pragma omp parallel num_threads(threads)
+#endif
+        {
+            int thread = 0;
+#ifdef OMP_ENABLE
+            thread = omp_get_thread_num();
+            // static schedule hands out ascending contiguous chunks in thread
+            // order, which keeps the bins in submission order
+#pragma omp for schedule(static)
+#endif
+            for (int i = int(first); i < n; i++) {
+                const RasterTriangle& rt = raster_triangles[i];
+                if (!rt.visible) {
+                    continue;
                 }
+                const auto& v = rt.triangle.v;
+                binner.bin(
+                    thread, i,
+                    std::min({v[0].coord.x, v[1].coord.x, v[2].coord.x}),
+                    std::min({v[0].coord.y, v[1].coord.y, v[2].coord.y}),
+                    std::max({v[0].coord.x, v[1].coord.x, v[2].coord.x}),
+                    std::max({v[0].coord.y, v[1].coord.y, v[2].coord.y}));
             }
         }
     }
-    void draw(const Triangle& triangle, const std::array<Vec3, 3>& view_pos,
-              const std::array<Vec3, 3>& world_pos, Material* material,
-              const std::array<float, 3>& ws) {
+    // raster phase, every tile is owned by exactly one thread so the
+    // framebuffer is written without any synchronization
+    template <typename Config>
+    void rasterizeTiles(RasterPass pass) {
+        int n = binner.tileCount();
+#ifdef OMP_ENABLE
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int tile = 0; tile < n; tile++) {
+            TileRect rect = binner.getTileRect(tile);
+            ShadeQueue queue;
+            binner.forEachTriangle(tile, [&](uint32_t id) {
+                this->draw<Config>(raster_triangles[id], id, rect, pass,
+                                   queue);
+            });
+            flushShadeQueue<Config>(queue);
+        }
+    }
+    // rasterize the part of triangle id inside rect, the fragments it shades
+    // may wait in queue
+    template <typename Config>
+    void draw(const RasterTriangle& rt, uint32_t id, const TileRect& rect,
+              RasterPass pass, ShadeQueue& queue) {
+        const Triangle& triangle = rt.triangle;
+        const FixedTriangleSetup& fixed = rt.fixed;
+        const TriangleSetup& setup = rt.setup;
+        if (fixed.degenerate()) {
+            return;
+        }
         Vec3 bounding_box[2] = {
             Vec3(std::numeric_limits<float>::infinity(),
                  std::numeric_limits<float>::infinity(), 0),
@@ -242,102 +908,599 @@ class Scene {
         for (auto& vertex : triangle.v) {
             float u = vertex.coord.x;
             float v = vertex.coord.y;
-            bounding_box[0].x =
-                std::max(std::min(bounding_box[0].x, std::floor(u)), 0.0f);
-            bounding_box[0].y =
-                std::max(std::min(bounding_box[0].y, std::floor(v)), 0.0f);
+            bounding_box[0].x = std::max(
+                std::min(bounding_box[0].x, std::floor(u)), float(rect.x0));
+            bounding_box[0].y = std::max(
+                std::min(bounding_box[0].y, std::floor(v)), float(rect.y0));
             bounding_box[1].x = std::min(
-                float(width), std::max(bounding_box[1].x, std::ceil(u)));
+                float(rect.x1), std::max(bounding_box[1].x, std::ceil(u)));
             bounding_box[1].y = std::min(
-                float(height), std::max(bounding_box[1].y, std::ceil(v)));
-        }
-        for (int y = bounding_box[0].y; y < bounding_box[1].y; y++) {
-            for (int x = bounding_box[0].x; x < bounding_box[1].x; x++) {
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-                int inside_cnt = 0;
-                RGBColor color(0);
-                for (int i = 0; i < AA_SAMPLE_RATIO_SQR; i++) {
-                    float xf = float(x) + AA_SAMPLE_OFFSET +
-                               AA_SAMPLE_STEP * float(i % AA_SAMPLE_RATIO),
-                          yf = float(y) + AA_SAMPLE_OFFSET +
-                               AA_SAMPLE_STEP * float(i / AA_SAMPLE_RATIO);
-#else
-                float xf = float(x) + 0.5f, yf = float(y) + 0.5f;
-#endif
-
-                    if (triangle.inside(Vec3(xf, yf, 0.0))) {
-                        auto [alpha, beta, gamma] =
-                            triangle.computeBarycentric2D(xf, yf);
-                        float Z = 1.f / (alpha / ws[0] + beta / ws[1] +
-                                         gamma / ws[2]);
-                        float zp = alpha * triangle.v[0].coord.z / ws[0] +
-                                   beta * triangle.v[1].coord.z / ws[1] +
-                                   gamma * triangle.v[2].coord.z / ws[2];
-                        zp *= Z;
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-                        if (Z > zbuffer[y][x][i]) {
-                            inside_cnt++;
-#else
-                    if (Z > zbuffer[y][x]) {
-#endif
-                            Vec3 normal = alpha * triangle.v[0].normal / ws[0] +
-                                          beta * triangle.v[1].normal / ws[1] +
-                                          gamma * triangle.v[2].normal / ws[2];
-                            normal = (normal * Z).normalized();
-                            Vec3 view_position = view_pos[0] * alpha +
-                                                 view_pos[1] * beta +
-                                                 view_pos[2] * gamma;
-                            FragmentShaderPayload payload;
-                            payload.normal = normal;
-                            payload.view_position = view_position;
-                            payload.screen_position = Vec3(xf, yf, 0.0f);
-                            payload.texture_coord =
-                                (alpha * triangle.v[0].texture_coord / ws[0] +
-                                 beta * triangle.v[1].texture_coord / ws[1] +
-                                 gamma * triangle.v[2].texture_coord / ws[2]) *
-                                Z;
-                            payload.color =
-                                (alpha * triangle.v[0].color / ws[0] +
-                                 beta * triangle.v[1].color / ws[1] +
-                                 gamma * triangle.v[2].color / ws[2]) *
-                                Z;
-                            payload.eye_pos = cam.eye_pos;
-                            payload.lights = this->lights;
-                            payload.material = material;
-                            // visibility from shadow
-                            float vis = lights.size() == 0 ? 1.f : 0.f;
-                            Vec3 frag_world_pos =
-                                (alpha * world_pos[0] / ws[0] +
-                                 beta * world_pos[1] / ws[1] +
-                                 gamma * world_pos[2] / ws[2]) *
-                                Z;
-                            for (auto light : lights) {
-                                vis += light->computeVisibility(frag_world_pos);
-                            }
-                            vis = std::min(vis, 1.0f);
-
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-                            colorbuffer[y][x][i] =
-                                fragment_shader(payload) * vis;
-                            zbuffer[y][x][i] = Z;
-#else
-                        pixels[y][x] = fragment_shader(payload) * vis;
-
-                        zbuffer[y][x] = Z;
-#endif
+                float(rect.y1), std::max(bounding_box[1].y, std::ceil(v)));
+        }
+        int x_min = bounding_box[0].x, y_min = bounding_box[0].y,
+            x_max = bounding_box[1].x, y_max = bounding_box[1].y;
+        if (rt.path == RasterPath::MICRO &&
+            !coveredPixels<Config>(fixed, x_min, y_min, x_max, y_max)) {
+            return;
+        }
+        // edge offsets of every sample from the pixel corner, the sample
+        // positions lie on the subpixel grid
+        SampleSteps<Config> sample_steps;
+        for (int i = 0; i < Config::samples; i++) {
+            std::array<float, 2> position = Config::samplePosition(i);
+            sample_steps.steps[i] = setup.step(position[0], position[1]);
+            sample_steps.fixed_steps[i] = fixed.step(
+                std::lround(position[0] * SUBPIXEL_SCALE),
+                std::lround(position[1] * SUBPIXEL_SCALE));
+        }
+        RasterBlock block;
+        block.inv_area = setup.inv_area;
+        for (int k = 0; k < 3; k++) {
+            block.ide[k] = int32_t(fixed.a[k] * SUBPIXEL_SCALE);
+            block.de[k] = setup.a[k];
+            block.inv_w[k] = 1.0f / rt.ws[k];
+        }
+        if (x_min >= x_max || y_min >= y_max) {
+            return;
+        }
+        // nearest depth of the triangle, z is harmonically interpolated
+        // between the vertex ws, which bounds it unless it crosses w = 0
+        float z_max = std::max({rt.ws[0], rt.ws[1], rt.ws[2]});
+        if (z_max >= 0.0f) {
+            z_max = std::numeric_limits<float>::infinity();
+        } else if (pass == RasterPass::DEPTH_EQUAL) {
+            // the hi-z tests are strict, a triangle may only be level with
+            // the depth it wrote in the prepass
+            z_max = std::nextafter(z_max, 0.0f);
+        }
+        HiZBuffer& hiz = framebuffer.hiz;
+        if (hiz.occluded(x_min, y_min, x_max, y_max, z_max)) {
+            return;
+        }
+        // walk the 8x8 framebuffer tiles, a tile row is one block
+        int tx0 = x_min / FRAMEBUFFER_TILE_SIZE,
+            ty0 = y_min / FRAMEBUFFER_TILE_SIZE,
+            tx1 = (x_max - 1) / FRAMEBUFFER_TILE_SIZE,
+            ty1 = (y_max - 1) / FRAMEBUFFER_TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            int y0 = std::max(y_min, ty * FRAMEBUFFER_TILE_SIZE),
+                y1 = std::min(y_max, (ty + 1) * FRAMEBUFFER_TILE_SIZE);
+            for (int tx = tx0; tx <= tx1; tx++) {
+                if (!(z_max > hiz.getTile(tx, ty))) {
+                    continue;
+                }
+                int x0 = std::max(x_min, tx * FRAMEBUFFER_TILE_SIZE),
+                    x1 = std::min(x_max, (tx + 1) * FRAMEBUFFER_TILE_SIZE);
+                RectCoverage coverage = RectCoverage::PARTIAL;
+                if (rt.path == RasterPath::LARGE) {
+                    // sample positions of the tile's pixels
+                    coverage = fixed.classify(
+                        int64_t(x0) * SUBPIXEL_SCALE,
+                        int64_t(y0) * SUBPIXEL_SCALE,
+                        int64_t(x1) * SUBPIXEL_SCALE - 1,
+                        int64_t(y1) * SUBPIXEL_SCALE - 1);
+                    if (coverage == RectCoverage::OUTSIDE) {
+                        continue;
+                    }
+                }
+                framebuffer.prepareTile(tx, ty);
+                block.lanes = x1 - x0;
+                // edge values at the corner of the first pixel of the span,
+                // inside every edge the fixed ones stay far from negative
+                SpanEdges e_row{setup.evaluate(x0, y0),
+                                {FIXED_EDGE_CLAMP, FIXED_EDGE_CLAMP,
+                                 FIXED_EDGE_CLAMP}};
+                if (coverage == RectCoverage::INSIDE) {
+                    for (int k = 0; k < 3; k++) {
+                        block.ide[k] = 0;
+                    }
+                } else {
+                    e_row.fixed = fixed.evaluateBiased(
+                        int64_t(x0) * SUBPIXEL_SCALE,
+                        int64_t(y0) * SUBPIXEL_SCALE);
+                }
+                bool written = false;
+                for (int y = y0; y < y1; y++) {
+                    written |= drawSpan<Config>(rt, id, sample_steps, e_row,
+                                                x0, y, block, pass, queue);
+                    for (int k = 0; k < 3; k++) {
+                        e_row.e[k] += setup.b[k];
+                        e_row.fixed[k] += fixed.b[k] * SUBPIXEL_SCALE;
+                    }
+                }
+                if (written && pass != RasterPass::DEPTH_EQUAL) {
+                    framebuffer.updateHiZTile(tx, ty);
+                }
+                if (coverage == RectCoverage::INSIDE) {
+                    for (int k = 0; k < 3; k++) {
+                        block.ide[k] = int32_t(fixed.a[k] * SUBPIXEL_SCALE);
+                    }
+                }
+            }
+        }
+    }
+    // micro triangles only, tests every sample of the box directly and
+    // shrinks it to the pixels with a covered sample, false if there are none
+    template <typename Config>
+    bool coveredPixels(const FixedTriangleSetup& fixed, int& x_min,
+                       int& y_min, int& x_max, int& y_max) const {
+        std::array<std::array<int64_t, 2>, Config::samples> offsets;
+        for (int i = 0; i < Config::samples; i++) {
+            std::array<float, 2> position = Config::samplePosition(i);
+            offsets[i] = {std::lround(position[0] * SUBPIXEL_SCALE),
+                          std::lround(position[1] * SUBPIXEL_SCALE)};
+        }
+        int cx_min = x_max, cy_min = y_max, cx_max = x_min, cy_max = y_min;
+        for (int y = y_min; y < y_max; y++) {
+            for (int x = x_min; x < x_max; x++) {
+                for (int i = 0; i < Config::samples; i++) {
+                    auto e = fixed.evaluateBiased(
+                        int64_t(x) * SUBPIXEL_SCALE + offsets[i][0],
+                        int64_t(y) * SUBPIXEL_SCALE + offsets[i][1]);
+                    if (e[0] >= 0 && e[1] >= 0 && e[2] >= 0) {
+                        cx_min = std::min(cx_min, x);
+                        cy_min = std::min(cy_min, y);
+                        cx_max = std::max(cx_max, x + 1);
+                        cy_max = std::max(cy_max, y + 1);
+                        break;
+                    }
+                }
+            }
+        }
+        x_min = cx_min;
+        y_min = cy_min;
+        x_max = cx_max;
+        y_max = cy_max;
+        return x_min < x_max;
+    }
+    // rasterize block.lanes pixels starting at (x0, y), returns true if any
+    // sample was written
+    template <typename Config>
+    bool drawSpan(const RasterTriangle& rt, uint32_t id,
+                  const SampleSteps<Config>& sample_steps,
+                  const SpanEdges& e_span, int x0, int y, RasterBlock& block,
+                  RasterPass pass, ShadeQueue& queue) {
+        // bit l is set if any sample of pixel x0 + l was written
+        unsigned written = 0;
+        // msaa only, samples of every pixel that passed, and the attributes
+        // of the first one
+        std::array<unsigned, RASTER_BLOCK_SIZE> covered{};
+        std::array<int, RASTER_BLOCK_SIZE> first_sample;
+        float first_persp[3][RASTER_BLOCK_SIZE];
+        for (int i = 0; i < Config::samples; i++) {
+            e_span.load(sample_steps.steps[i], sample_steps.fixed_steps[i],
+                        block);
+            for (int l = 0; l < block.lanes; l++) {
+                block.depth[l] = framebuffer.getDepth(x0 + l, y, i);
+            }
+            if (pass == RasterPass::DEPTH_EQUAL) {
+                // the kernel tests z > stored, moving the stored depth one
+                // ulp farther turns it into z >= stored, the prepass already
+                // stored the nearest z and the kernel reproduces it exactly
+                const float far = -std::numeric_limits<float>::infinity();
+                for (int l = 0; l < block.lanes; l++) {
+                    block.depth[l] = std::nextafter(block.depth[l], far);
+                }
+            }
+            rasterizeBlock(block);
+            if (block.mask == 0) {
+                continue;
+            }
+            written |= block.mask;
+            std::array<float, 2> position = Config::samplePosition(i);
+            for (int l = 0; l < block.lanes; l++) {
+                if (!(block.mask >> l & 1u)) {
+                    continue;
+                }
+                int x = x0 + l;
+                if (pass != RasterPass::DEPTH_EQUAL) {
+                    framebuffer.setDepth(x, y, i, block.depth[l]);
+                }
+                if (pass == RasterPass::DEPTH_ONLY) {
+                    continue;
+                }
+                if (pass == RasterPass::VISIBILITY) {
+                    framebuffer.setVisible(x, y, i, id,
+                                           {block.persp[0][l],
+                                            block.persp[1][l],
+                                            block.persp[2][l]});
+                    covered[l] |= 1u << i;
+                    continue;
+                }
+                if constexpr (Config::aa_mode == AAMode::MSAA) {
+                    // shaded once per pixel after every sample is tested
+                    if (covered[l] == 0) {
+                        first_sample[l] = i;
+                        for (int k = 0; k < 3; k++) {
+                            first_persp[k][l] = block.persp[k][l];
                         }
                     }
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-                    color = color + colorbuffer[y][x][i];
+                    covered[l] |= 1u << i;
+                    continue;
+                }
+                queueFragment<Config>(
+                    queue, rt,
+                    {block.persp[0][l], block.persp[1][l], block.persp[2][l]},
+                    float(x) + position[0], float(y) + position[1], x, y,
+                    1u << i);
+            }
+        }
+        if constexpr (Config::aa_mode == AAMode::MSAA) {
+            if (pass == RasterPass::VISIBILITY && written != 0) {
+                storeShadingPoints<Config>(rt, e_span, x0, y, block, covered);
+            }
+        }
+        if (pass != RasterPass::FORWARD && pass != RasterPass::DEPTH_EQUAL) {
+            return written != 0;
+        }
+        if constexpr (Config::aa_mode == AAMode::MSAA) {
+            if (written != 0) {
+                shadePixels<Config>(rt, e_span, x0, y, block, covered,
+                                    first_sample, first_persp, queue);
+            }
+        }
+        if constexpr (Config::aa_mode != AAMode::NONE) {
+            for (int l = 0; l < block.lanes; l++) {
+                if (written >> l & 1u) {
+                    queueResolve<Config>(queue, x0 + l, y);
                 }
-                if (inside_cnt != 0) {
-                    pixels[y][x] = color / AA_SAMPLE_RATIO_SQR;
+            }
+        }
+        return written != 0;
+    }
+    // msaa only, shade every pixel of a span once and queue its color for its
+    // covered samples, the shading point is the pixel center if it's inside
+    // the triangle and the first covered sample otherwise, so attributes are
+    // never extrapolated, like centroid sampling
+    template <typename Config>
+    void shadePixels(
+        const RasterTriangle& rt, const SpanEdges& e_span, int x0, int y,
+        RasterBlock& block,
+        const std::array<unsigned, RASTER_BLOCK_SIZE>& covered,
+        const std::array<int, RASTER_BLOCK_SIZE>& first_sample,
+        const float (&first_persp)[3][RASTER_BLOCK_SIZE], ShadeQueue& queue) {
+        rasterizePixelCenters(rt, e_span, block);
+        for (int l = 0; l < block.lanes; l++) {
+            if (covered[l] == 0) {
+                continue;
+            }
+            int x = x0 + l;
+            if (block.mask >> l & 1u) {
+                queueFragment<Config>(
+                    queue, rt,
+                    {block.persp[0][l], block.persp[1][l], block.persp[2][l]},
+                    float(x) + 0.5f, float(y) + 0.5f, x, y, covered[l]);
+            } else {
+                std::array<float, 2> position =
+                    Config::samplePosition(first_sample[l]);
+                queueFragment<Config>(
+                    queue, rt,
+                    {first_persp[0][l], first_persp[1][l], first_persp[2][l]},
+                    float(x) + position[0], float(y) + position[1], x, y,
+                    covered[l]);
+            }
+        }
+    }
+    // msaa only, the pixel centers of a span without a depth test, the mask
+    // has the pixels whose center is inside the triangle
+    void rasterizePixelCenters(const RasterTriangle& rt,
+                               const SpanEdges& e_span,
+                               RasterBlock& block) const {
+        constexpr int64_t center = SUBPIXEL_SCALE / 2;
+        e_span.load(rt.setup.step(0.5f, 0.5f), rt.fixed.step(center, center),
+                    block);
+        for (int l = 0; l < block.lanes; l++) {
+            block.depth[l] = -std::numeric_limits<float>::infinity();
+        }
+        rasterizeBlock(block);
+    }
+    // msaa visibility pass only, the samples a triangle covers in a pixel all
+    // store the barycentrics of the point shadePixels shades the pixel at,
+    // the center if it's inside and the first covered sample otherwise
+    template <typename Config>
+    void storeShadingPoints(
+        const RasterTriangle& rt, const SpanEdges& e_span, int x0, int y,
+        RasterBlock& block,
+        const std::array<unsigned, RASTER_BLOCK_SIZE>& covered) {
+        rasterizePixelCenters(rt, e_span, block);
+        for (int l = 0; l < block.lanes; l++) {
+            if (covered[l] == 0) {
+                continue;
+            }
+            int x = x0 + l;
+            std::array<float, 3> persp;
+            if (block.mask >> l & 1u) {
+                persp = {block.persp[0][l], block.persp[1][l],
+                         block.persp[2][l]};
+            } else {
+                int first = 0;
+                while (!(covered[l] >> first & 1u)) {
+                    first++;
                 }
+                persp = framebuffer.getVisibleBary(
+                    framebuffer.sampleIndex(x, y, first));
+            }
+            for (int i = 0; i < Config::samples; i++) {
+                if (covered[l] >> i & 1u) {
+                    framebuffer.setVisibleBary(framebuffer.sampleIndex(x, y, i),
+                                               persp);
+                }
+            }
+        }
+    }
+    // msaa only, whether the center of pixel (x, y) is inside the triangle,
+    // the exact fixed point test rasterizePixelCenters does
+    bool centerInside(const RasterTriangle& rt, int x, int y) const {
+        constexpr int64_t center = SUBPIXEL_SCALE / 2;
+        auto e = rt.fixed.evaluateBiased(int64_t(x) * SUBPIXEL_SCALE + center,
+                                         int64_t(y) * SUBPIXEL_SCALE + center);
+        return e[0] >= 0 && e[1] >= 0 && e[2] >= 0;
+    }
+    template <typename Config>
+    void resolvePixel(int x, int y) {
+        RGBColor color(0);
+        for (int i = 0; i < Config::samples; i++) {
+            color = color + framebuffer.getSampleColor(x, y, i);
+        }
+        framebuffer.setPixel(x, y, color / Config::samples);
+    }
+    // shading pass of the visibility buffer mode, every visible sample is
+    // shaded exactly once, bin tiles are independent, walked one framebuffer
+    // tile at a time in the order forward shading visits them, so nearby
+    // fragments share the texels and shadow map texels they fetch
+    template <typename Config>
+    void shadeVisibilityBuffer() {
+        int n = binner.tileCount();
+#ifdef OMP_ENABLE
+#pragma omp parallel for schedule(dynamic)
 #endif
+        for (int tile = 0; tile < n; tile++) {
+            TileRect rect = binner.getTileRect(tile);
+            ShadeQueue queue;
+            for (int y0 = rect.y0; y0 < rect.y1; y0 += FRAMEBUFFER_TILE_SIZE) {
+                for (int x0 = rect.x0; x0 < rect.x1;
+                     x0 += FRAMEBUFFER_TILE_SIZE) {
+                    // nothing was drawn to tiles that are still cleared
+                    if (framebuffer.clearPending(
+                            x0 >> FRAMEBUFFER_TILE_SHIFT,
+                            y0 >> FRAMEBUFFER_TILE_SHIFT)) {
+                        continue;
+                    }
+                    int x1 = std::min(x0 + FRAMEBUFFER_TILE_SIZE, rect.x1),
+                        y1 = std::min(y0 + FRAMEBUFFER_TILE_SIZE, rect.y1);
+                    for (int y = y0; y < y1; y++) {
+                        for (int x = x0; x < x1; x++) {
+                            shadeVisiblePixel<Config>(queue, x, y);
+                        }
+                    }
+                }
+            }
+            flushShadeQueue<Config>(queue);
+        }
+    }
+    // queue the visible samples of pixel (x, y) and, with aa, its resolve
+    template <typename Config>
+    void shadeVisiblePixel(ShadeQueue& queue, int x, int y) {
+        // samples of the pixel that are visible or already queued
+        unsigned visible = 0, queued = 0;
+        for (int i = 0; i < Config::samples; i++) {
+            uint32_t id = framebuffer.getVisibleId(x, y, i);
+            if (id == VISIBILITY_EMPTY) {
+                continue;
+            }
+            visible |= 1u << i;
+            if (queued >> i & 1u) {
+                continue;
+            }
+            unsigned samples = 1u << i;
+            if constexpr (Config::aa_mode == AAMode::MSAA) {
+                // a triangle is shaded once per pixel, at its first visible
+                // sample, the color goes to all of them
+                for (int j = i + 1; j < Config::samples; j++) {
+                    if (framebuffer.getVisibleId(x, y, j) == id) {
+                        samples |= 1u << j;
+                    }
+                }
+            }
+            queued |= samples;
+            const RasterTriangle& rt = raster_triangles[id];
+            // stored as the raster kernel computed them, so the fragment
+            // matches the forward one bit for bit, under msaa they are the
+            // ones of the pixel's shading point, only its screen position is
+            // the visible sample's if the center is outside
+            std::array<float, 3> persp =
+                framebuffer.getVisibleBary(framebuffer.sampleIndex(x, y, i));
+            std::array<float, 2> position = Config::samplePosition(i);
+            float xf = float(x) + position[0], yf = float(y) + position[1];
+            if constexpr (Config::aa_mode == AAMode::MSAA) {
+                if (centerInside(rt, x, y)) {
+                    xf = float(x) + 0.5f;
+                    yf = float(y) + 0.5f;
+                }
+            }
+            queueFragment<Config>(queue, rt, persp, xf, yf, x, y, samples);
+        }
+        if constexpr (Config::aa_mode != AAMode::NONE) {
+            if (visible != 0) {
+                queueResolve<Config>(queue, x, y);
+            }
+        }
+    }
+    // add a sample with the given perspective correct barycentrics to the
+    // queue, its color goes to the given samples of pixel (x, y)
+    template <typename Config>
+    void queueFragment(ShadeQueue& queue, const RasterTriangle& rt,
+                       const std::array<float, 3>& persp, float xf, float yf,
+                       int x, int y, unsigned samples) {
+        if (queue.lanes == SHADE_PACKET_SIZE ||
+            (queue.lanes > 0 && queue.packet.material != rt.material)) {
+            flushShadeQueue<Config>(queue);
+        }
+        int l = queue.lanes++;
+        queue.x[l] = x;
+        queue.y[l] = y;
+        queue.samples[l] = samples;
+        setPacketLane<Config>(queue.packet, queue.visibility, rt, l, persp, xf,
+                              yf);
+    }
+    // aa only, resolve pixel (x, y) once the queued lanes are written
+    template <typename Config>
+    void queueResolve(ShadeQueue& queue, int x, int y) {
+        if (queue.resolve_count == SHADE_QUEUE_RESOLVES) {
+            flushShadeQueue<Config>(queue);
+        }
+        queue.resolves[queue.resolve_count++] = {x, y};
+    }
+    // shade the queued lanes, write their colors and resolve the queued
+    // pixels
+    template <typename Config>
+    void flushShadeQueue(ShadeQueue& queue) {
+        if (queue.lanes > 0) {
+            FragmentPacket& packet = queue.packet;
+            shadePacket<Config>(packet, queue.visibility);
+            for (int l = 0; l < queue.lanes; l++) {
+                RGBColor color(packet.out[0][l], packet.out[1][l],
+                               packet.out[2][l]);
+                if constexpr (Config::aa_mode == AAMode::NONE) {
+                    framebuffer.setPixel(queue.x[l], queue.y[l], color);
+                } else {
+                    for (int i = 0; i < Config::samples; i++) {
+                        if (queue.samples[l] >> i & 1u) {
+                            framebuffer.setSampleColor(queue.x[l], queue.y[l],
+                                                       i, color);
+                        }
+                    }
+                }
+            }
+            queue.lanes = 0;
+            packet.mask = 0;
+        }
+        if constexpr (Config::aa_mode != AAMode::NONE) {
+            for (int r = 0; r < queue.resolve_count; r++) {
+                resolvePixel<Config>(queue.resolves[r][0],
+                                     queue.resolves[r][1]);
+            }
+        }
+        queue.resolve_count = 0;
+    }
+    // interpolate the attributes of a sample with the given perspective
+    // correct barycentrics into lane l of a packet and look up its shadows,
+    // the packet takes the material of rt
+    template <typename Config>
+    void setPacketLane(FragmentPacket& packet,
+                       float (&visibility)[SHADE_PACKET_SIZE],
+                       const RasterTriangle& rt, int l,
+                       const std::array<float, 3>& persp, float xf,
+                       float yf) const {
+        const Triangle& triangle = rt.triangle;
+        float pa = persp[0], pb = persp[1], pg = persp[2];
+        Vec3 normal = (pa * triangle.v[0].normal + pb * triangle.v[1].normal +
+                       pg * triangle.v[2].normal)
+                          .normalized();
+        // perspective correct, clipped triangles reach the near plane where
+        // screen space interpolation is far off
+        Vec3 view_position = rt.view_pos[0] * pa + rt.view_pos[1] * pb +
+                             rt.view_pos[2] * pg;
+        Vec3 texture_coord = pa * triangle.v[0].texture_coord +
+                             pb * triangle.v[1].texture_coord +
+                             pg * triangle.v[2].texture_coord;
+        Vec3 color = pa * triangle.v[0].color + pb * triangle.v[1].color +
+                     pg * triangle.v[2].color;
+        const Vec3* attributes[4] = {&normal, &view_position, &texture_coord,
+                                     &color};
+        float(*lanes[4])[SHADE_PACKET_SIZE] = {
+            packet.normal, packet.view_position, packet.texture_coord,
+            packet.color};
+        for (int k = 0; k < 4; k++) {
+            lanes[k][0][l] = attributes[k]->x;
+            lanes[k][1][l] = attributes[k]->y;
+            lanes[k][2][l] = attributes[k]->z;
+        }
+        packet.screen_position[0][l] = xf;
+        packet.screen_position[1][l] = yf;
+        packet.material = rt.material;
+        packet.mask |= 1u << l;
+        if constexpr (!Config::shadows) {
+            return;
+        }
+        // visibility from shadow
+        float vis = uniforms.lights.size() == 0 ? 1.f : 0.f;
+        Vec3 frag_world_pos = pa * rt.world_pos[0] + pb * rt.world_pos[1] +
+                              pg * rt.world_pos[2];
+        for (size_t i = 0; i < uniforms.lights.size(); i++) {
+            vis += uniforms.lights[i]->computeVisibility(
+                frag_world_pos, uniforms.shadow_matrices[i]);
+        }
+        visibility[l] = std::min(vis, 1.0f);
+    }
+    // run the fragment shader on the lanes in packet.mask, the other lanes
+    // repeat the first one so a simd shader sees only valid fragments
+    template <typename Config>
+    void shadePacket(FragmentPacket& packet,
+                     const float (&visibility)[SHADE_PACKET_SIZE]) const {
+        int first = 0;
+        while (!(packet.mask >> first & 1u)) {
+            first++;
+        }
+        for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+            if (packet.mask >> l & 1u) {
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                packet.normal[c][l] = packet.normal[c][first];
+                packet.view_position[c][l] = packet.view_position[c][first];
+                packet.texture_coord[c][l] = packet.texture_coord[c][first];
+                packet.color[c][l] = packet.color[c][first];
+            }
+            packet.screen_position[0][l] = packet.screen_position[0][first];
+            packet.screen_position[1][l] = packet.screen_position[1][first];
+        }
+        packet.uniforms = &uniforms;
+        if constexpr (std::is_same_v<typename Config::shader, DynamicShader>) {
+            for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+                if (packet.mask >> l & 1u) {
+                    FragmentShaderPayload payload = packet.payload(l);
+                    packet.setOut(l, fragment_shader(payload));
+                }
+            }
+        } else {
+            Config::shader::shadePacket(packet);
+        }
+        if constexpr (Config::shadows) {
+            for (int c = 0; c < 3; c++) {
+                for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+                    packet.out[c][l] *= visibility[l];
+                }
             }
         }
     }
     void setCamera(const Camera& cam) { this->cam = cam; }
+    // reallocates the framebuffer, the scene has to be rendered again
+    void setRenderSettings(const RenderSettings& settings) {
+        this->settings = settings.normalized();
+        framebuffer = FrameBuffer(width, height, this->settings.samples,
+                                  this->settings.layout);
+        render_passes = select_render_passes(this->settings);
+        setShadingMode(this->settings.shading_mode);
+    }
+    template <typename S>
+    void setFragmentShader(const FragmentShader<S>& shader) {
+        fragment_shader = static_cast<const S&>(shader);
+        select_render_passes = &Scene::selectRenderPasses<S>;
+        render_passes = select_render_passes(settings);
+    }
+    // slow path, every sample calls the shader through std::function
+    void setFragmentShader(Shader shader) {
+        fragment_shader = std::move(shader);
+        select_render_passes = &Scene::selectRenderPasses<DynamicShader>;
+        render_passes = select_render_passes(settings);
+    }
+    void setShadingMode(ShadingMode mode) {
+        settings.shading_mode = mode;
+        if (mode == ShadingMode::VISIBILITY_BUFFER) {
+            framebuffer.enableVisibility();
+        }
+    }
     void addModel(Model* model) { this->models.emplace_back(model); }
     void addLight(Light* light) { this->lights.push_back(light); }
     void dumpToPPM(const std::string& path) {
@@ -348,54 +1511,24 @@ class Scene {
         ofs.write(" ", 1);
         ofs.write(hs.c_str(), hs.length());
         ofs.write(" 255\n", 5);
-        for (auto& row : pixels) {
-            for (auto& pixel : row) {
-                Vec3 p255 = pixel * 255.0f;
-                char x = p255.x, y = p255.y, z = p255.z;
-                ofs.write(&x, 1);
-                ofs.write(&y, 1);
-                ofs.write(&z, 1);
-            }
+        std::vector<unsigned char> image(width * height * 4);
+        framebuffer.toRGBA8(image.data());
+        for (int i = 0; i < width * height; i++) {
+            ofs.write(reinterpret_cast<char*>(&image[i * 4]), 3);
         }
         ofs.flush();
         ofs.close();
     }
     void dumpToPNG(const std::string& path) {
-        std::vector<unsigned char> image;
-        image.resize(pixels.size() * pixels[0].size() * 4);
-        int i = 0;
-        for (auto& row : pixels) {
-            for (auto& pixel : row) {
-                Vec3 p255 = pixel * 255.0f;
-                unsigned char r = p255.x, g = p255.y, b = p255.z, a = 255;
-                image[i++] = r;
-                image[i++] = g;
-                image[i++] = b;
-                image[i++] = a;
-            }
-        }
+        std::vector<unsigned char> image(width * height * 4);
+        framebuffer.toRGBA8(image.data());
         unsigned error = lodepng::encode(path, image, width, height);
         if (error) {
             std::cerr << "dump to png failed: " << lodepng_error_text(error);
             exit(1);
         }
     }
-    void clear() {
-        for (int i = 0; i < height; i++) {
-            std::fill(pixels[i].begin(), pixels[i].end(), RGBColor(0));
-#if defined(SSAA_ENABLE) || defined(MSAA_ENABLE)
-            for (int j = 0; j < width; j++) {
-                std::fill(zbuffer[i][j].begin(), zbuffer[i][j].end(),
-                          -std::numeric_limits<float>::infinity());
-                std::fill(colorbuffer[i][j].begin(), colorbuffer[i][j].end(),
-                          RGBColor(0.0f));
-            }
-#else
-            std::fill(zbuffer[i].begin(), zbuffer[i].end(),
-                      -std::numeric_limits<float>::infinity());
-#endif
-        }
-    }
+    void clear() { framebuffer.clear(); }
 };
 
 }  // namespace Rasterizer
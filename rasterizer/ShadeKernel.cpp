@@ -0,0 +1,56 @@
+#include "rasterizer/ShadeKernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Rasterizer;
+void Rasterizer::shadeBlinnPhongScalar(BlinnPhongPacket& packet) {
+    for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+        Vec3 normal(packet.normal[0][l], packet.normal[1][l],
+                    packet.normal[2][l]),
+            position(packet.position[0][l], packet.position[1][l],
+                     packet.position[2][l]),
+            ka(packet.ka[0][l], packet.ka[1][l], packet.ka[2][l]),
+            kd(packet.kd[0][l], packet.kd[1][l], packet.kd[2][l]),
+            ks(packet.ks[0][l], packet.ks[1][l], packet.ks[2][l]);
+        Vec3 eye_vec = (packet.eye_pos - position).normalized();
+        RGBColor color;
+        for (size_t i = 0; i < packet.light_count; i++) {
+            const Light* light = packet.lights[i];
+            float light_point_dist_sq = (light->position - position).norm2();
+            Vec3 light_indensity = light->intensity / light_point_dist_sq;
+            Vec3 light_vec = (light->position - position).normalized();
+            RGBColor ambient = Vec3(packet.ambient).cwiseProduct(ka);
+            RGBColor diffuse =
+                kd.cwiseProduct(light_indensity) *
+                std::max(0.0f, float(normal.dot(light_vec.normalized())));
+            RGBColor specular;
+            if (packet.specular) {
+                Vec3 half_vec = (light_vec + eye_vec).normalized();
+                specular = ks.cwiseProduct(light_indensity) *
+                           std::pow(std::max(normal.dot(half_vec), 0.0f),
+                                    packet.shininess);
+            }
+            color = color + ambient + diffuse + specular;
+        }
+        color = color.min(RGBColor(1.0f));
+        packet.color[0][l] = color.x;
+        packet.color[1][l] = color.y;
+        packet.color[2][l] = color.z;
+    }
+}
+
+#ifndef OPT_NEON
+void Rasterizer::shadeBlinnPhong(BlinnPhongPacket& packet) {
+#ifdef OPT_SSE
+    // the widest kernel the cpu runs, picked on the first call
+    static void (*const kernel)(BlinnPhongPacket&) =
+        cpuSupportsAVX2()    ? shadeBlinnPhongAVX2
+        : cpuSupportsSSE41() ? shadeBlinnPhongSSE
+                             : shadeBlinnPhongScalar;
+    kernel(packet);
+#else
+    shadeBlinnPhongScalar(packet);
+#endif
+}
+#endif
@@ -0,0 +1,105 @@
+#ifndef SHADEKERNEL_HPP
+#define SHADEKERNEL_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "rasterizer/Light.hpp"
+#include "rasterizer/Math.hpp"
+namespace Rasterizer {
+// fragments shaded by one kernel invocation, one AVX2 register
+static constexpr int SHADE_PACKET_SIZE = 8;
+
+// polynomials of specularPow(), the simd kernels evaluate the same ones
+// 2 / ln 2 times 1, 1/3, 1/5, 1/7: log2((1 + t) / (1 - t)) in odd powers of t
+static constexpr float LOG2_C1 = 2.885390082f;
+static constexpr float LOG2_C3 = 0.9617966939f;
+static constexpr float LOG2_C5 = 0.5770780164f;
+static constexpr float LOG2_C7 = 0.4121985831f;
+// cephes exp2f, 2^f for f in [-0.5, 0.5]
+static constexpr float EXP2_C1 = 6.931472028550421e-1f;
+static constexpr float EXP2_C2 = 2.402264791363012e-1f;
+static constexpr float EXP2_C3 = 5.550332471162809e-2f;
+static constexpr float EXP2_C4 = 9.618437357674640e-3f;
+static constexpr float EXP2_C5 = 1.339887440266574e-3f;
+static constexpr float EXP2_C6 = 1.535336188319500e-4f;
+
+// pow(x, n) for the specular term, x in [0, 1] and n >= 0, computed as
+// exp2(n * log2(x)) with short polynomials, within 5e-5 of std::pow
+// relative to the result, results below FLT_MIN are flushed to zero. the
+// simd kernels evaluate it lane-wise, a single lane is no faster than
+// std::pow so the scalar shaders keep that
+inline float specularPow(float x, float n) {
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2))
+    uint32_t bits;
+    float clamped = std::max(x, 1.17549435e-38f);
+    std::memcpy(&bits, &clamped, sizeof(bits));
+    int e = int(bits >> 23) - 127;
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e++;
+    }
+    float t = (m - 1.0f) / (m + 1.0f), t2 = t * t;
+    float log2_x =
+        float(e) +
+        t * (LOG2_C1 + t2 * (LOG2_C3 + t2 * (LOG2_C5 + t2 * LOG2_C7)));
+    float y = n * log2_x;
+    if (y < -126.0f) {
+        return 0.0f;
+    }
+    // 2^y = 2^i * 2^f with i the nearest integer
+    float i = std::nearbyint(y), f = y - i;
+    float p =
+        1.0f +
+        f * (EXP2_C1 +
+             f * (EXP2_C2 +
+                  f * (EXP2_C3 + f * (EXP2_C4 + f * (EXP2_C5 +
+                                                     f * EXP2_C6)))));
+    uint32_t scale_bits = uint32_t(int(i) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &scale_bits, sizeof(scale));
+    return p * scale;
+}
+
+// blinn-phong lighting of SHADE_PACKET_SIZE fragments, every lane is
+// computed, the caller ignores the ones without a fragment
+struct BlinnPhongPacket {
+    // in: view space, the normals are normalized
+    alignas(32) float normal[3][SHADE_PACKET_SIZE];
+    alignas(32) float position[3][SHADE_PACKET_SIZE];
+    // in: ambient, diffuse and specular coefficients
+    alignas(32) float ka[3][SHADE_PACKET_SIZE];
+    alignas(32) float kd[3][SHADE_PACKET_SIZE];
+    alignas(32) float ks[3][SHADE_PACKET_SIZE];
+    float shininess;
+    // in: false if the material has no highlights, ks is zero then
+    bool specular;
+    // in: ambient light, added once per light
+    float ambient;
+    Vec3 eye_pos;
+    Light* const* lights;
+    size_t light_count;
+    // out: clamped to 1
+    alignas(32) float color[3][SHADE_PACKET_SIZE];
+};
+
+// light every lane of a packet
+void shadeBlinnPhong(BlinnPhongPacket& packet);
+// portable reference implementation
+void shadeBlinnPhongScalar(BlinnPhongPacket& packet);
+#ifdef OPT_SSE
+void shadeBlinnPhongSSE(BlinnPhongPacket& packet);
+#endif
+#ifdef OPT_AVX2
+void shadeBlinnPhongAVX2(BlinnPhongPacket& packet);
+#endif
+#ifdef OPT_NEON
+void shadeBlinnPhongNeon(BlinnPhongPacket& packet);
+#endif
+}  // namespace Rasterizer
+#endif /* SHADEKERNEL_HPP */
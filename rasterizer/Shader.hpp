@@ -1,13 +1,29 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "rasterizer/Light.hpp"
 #include "rasterizer/Material.hpp"
 #include "rasterizer/Math.hpp"
+#include "rasterizer/ShadeKernel.hpp"
 #include "rasterizer/Texture.hpp"
 
 namespace Rasterizer {
+// constants of every fragment in a frame, built once before the raster
+// passes and read only while they run
+struct ShaderUniforms {
+    Vec3 eye_pos;
+    std::vector<Light*> lights;
+    // maps world positions to the shadow map uv and depth of each light
+    std::vector<Mat4> shadow_matrices;
+};
+// the varyings of one fragment, cheap to build for every sample
 struct FragmentShaderPayload {
     Vec3 normal;
     Vec3 view_position;
@@ -15,10 +31,296 @@ struct FragmentShaderPayload {
     Vec3 texture_coord;
     RGBColor color;
     Material* material;
-    Vec3 eye_pos;
-    std::vector<Light*> lights;
+    const ShaderUniforms* uniforms;
+};
+static_assert(std::is_trivially_copyable_v<FragmentShaderPayload>,
+              "the payload must not own anything");
+// up to SHADE_PACKET_SIZE fragments of one material shaded together, the
+// varyings are stored per lane, lanes outside mask repeat a fragment of the
+// packet, so a shader may compute every lane
+struct FragmentPacket {
+    alignas(32) float normal[3][SHADE_PACKET_SIZE];
+    alignas(32) float view_position[3][SHADE_PACKET_SIZE];
+    alignas(32) float screen_position[2][SHADE_PACKET_SIZE];
+    alignas(32) float texture_coord[3][SHADE_PACKET_SIZE];
+    alignas(32) float color[3][SHADE_PACKET_SIZE];
+    Material* material;
+    const ShaderUniforms* uniforms;
+    unsigned mask = 0;
+    // out: the shaded color of the lanes in mask
+    alignas(32) float out[3][SHADE_PACKET_SIZE];
+    FragmentShaderPayload payload(int l) const {
+        FragmentShaderPayload payload;
+        payload.normal = Vec3(normal[0][l], normal[1][l], normal[2][l]);
+        payload.view_position = Vec3(view_position[0][l],
+                                     view_position[1][l], view_position[2][l]);
+        payload.screen_position =
+            Vec3(screen_position[0][l], screen_position[1][l], 0.0f);
+        payload.texture_coord = Vec3(texture_coord[0][l], texture_coord[1][l],
+                                     texture_coord[2][l]);
+        payload.color = Vec3(color[0][l], color[1][l], color[2][l]);
+        payload.material = material;
+        payload.uniforms = uniforms;
+        return payload;
+    }
+    void setOut(int l, const RGBColor& c) {
+        out[0][l] = c.x;
+        out[1][l] = c.y;
+        out[2][l] = c.z;
+    }
 };
+// any callable, the scene calls it through std::function for every sample
 using Shader = std::function<RGBColor(FragmentShaderPayload&)>;
+
+// a shader known at compile time, the scene instantiates its raster loop
+// once per shader type and calls Derived::shade or Derived::shadePacket
+// directly, so the shading code is inlined into it
+template <typename Derived>
+struct FragmentShader {
+    RGBColor operator()(FragmentShaderPayload& payload) const {
+        return Derived::shade(payload);
+    }
+    // one lane at a time, shaders with a simd version hide this
+    static void shadePacket(FragmentPacket& packet) {
+        for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+            if (packet.mask >> l & 1u) {
+                FragmentShaderPayload payload = packet.payload(l);
+                packet.setOut(l, Derived::shade(payload));
+            }
+        }
+    }
+};
+// blinn-phong lighting of a packet with the coefficients already in
+// lighting, only the lanes in mask are meaningful
+inline void shadeBlinnPhongPacket(FragmentPacket& packet,
+                                  BlinnPhongPacket& lighting) {
+    const ShaderUniforms& uniforms = *packet.uniforms;
+    for (int c = 0; c < 3; c++) {
+        std::copy(std::begin(packet.normal[c]), std::end(packet.normal[c]),
+                  lighting.normal[c]);
+        std::copy(std::begin(packet.view_position[c]),
+                  std::end(packet.view_position[c]), lighting.position[c]);
+    }
+    lighting.eye_pos = uniforms.eye_pos;
+    lighting.lights = uniforms.lights.data();
+    lighting.light_count = uniforms.lights.size();
+    shadeBlinnPhong(lighting);
+    for (int c = 0; c < 3; c++) {
+        std::copy(std::begin(lighting.color[c]), std::end(lighting.color[c]),
+                  packet.out[c]);
+    }
+}
+// marks the std::function slow path
+struct DynamicShader {};
+
+// normals mapped to colors
+struct NormalShader : FragmentShader<NormalShader> {
+    static RGBColor shade(FragmentShaderPayload& payload) {
+        RGBColor color = (payload.normal + Vec3(1.0f)) / 2.f;
+        return color;
+    }
+};
+// blinn-phong lit with the textures of the material, instantiated once per
+// combination of material features, material->features picks the
+// instantiation once per fragment or packet, so the shader neither tests
+// for the maps nor computes a highlight the material doesn't have
+struct TextureShader : FragmentShader<TextureShader> {
+    template <unsigned FEATURES>
+    static RGBColor shadeFeatures(FragmentShaderPayload& payload) {
+        const Material* material = payload.material;
+        float u = payload.texture_coord.x, v = payload.texture_coord.y;
+        // coefficients for ambient, diffuse and specular lighting
+        Vec3 kd = coefficient<FEATURES & MATERIAL_KD_MAP>(material->Kd_tex,
+                                                          material->Kd, u, v);
+        if constexpr ((FEATURES & MATERIAL_UNLIT) != 0) {
+            return kd.min(RGBColor(1.0f));
+        }
+        Vec3 ka = coefficient<FEATURES & MATERIAL_KA_MAP>(material->Ka_tex,
+                                                          material->Ka, u, v);
+        Vec3 ks = coefficient<FEATURES & MATERIAL_KS_MAP>(material->Ks_tex,
+                                                          material->Ks, u, v);
+        float shiness = material->Ns;
+
+        const ShaderUniforms& uniforms = *payload.uniforms;
+        Vec3 eye_vec = (uniforms.eye_pos - payload.view_position).normalized();
+
+        Vec3 ambient_light_intensity(0.01);
+        RGBColor color;
+        for (auto light : uniforms.lights) {
+            float light_point_dist_sq =
+                (light->position - payload.view_position).norm2();
+            Vec3 light_indensity = light->intensity / light_point_dist_sq;
+            Vec3 light_vec =
+                (light->position - payload.view_position).normalized();
+
+            RGBColor ambient, diffuse, specular;
+            ambient = ambient_light_intensity.cwiseProduct(ka);
+            diffuse = kd.cwiseProduct(light_indensity) *
+                      std::max(0.0f, float(payload.normal.dot(
+                                         light_vec.normalized())));
+            if constexpr ((FEATURES & MATERIAL_SPECULAR) != 0) {
+                // bling-phong specular shading model
+                // https://www.cnblogs.com/bluebean/p/5299358.html
+                Vec3 half_vec = (light_vec + eye_vec).normalized();
+                specular = ks.cwiseProduct(light_indensity) *
+                           // negative fwd incident ray will be ignore
+                           std::pow(std::max(payload.normal.dot(half_vec),
+                                             0.0f),
+                                    shiness);
+            }
+            color = color + ambient + diffuse + specular;
+        }
+
+        return color.min(RGBColor(1.0f));
+    }
+    // textures are sampled per lane, the lighting runs on every lane at once
+    template <unsigned FEATURES>
+    static void shadePacketFeatures(FragmentPacket& packet) {
+        const Material* material = packet.material;
+        BlinnPhongPacket lighting;
+        coefficients<FEATURES & MATERIAL_KD_MAP>(packet, material->Kd_tex,
+                                                 material->Kd, lighting.kd);
+        if constexpr ((FEATURES & MATERIAL_UNLIT) != 0) {
+            for (int c = 0; c < 3; c++) {
+                for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+                    packet.out[c][l] = std::min(lighting.kd[c][l], 1.0f);
+                }
+            }
+            return;
+        }
+        coefficients<FEATURES & MATERIAL_KA_MAP>(packet, material->Ka_tex,
+                                                 material->Ka, lighting.ka);
+        if constexpr ((FEATURES & MATERIAL_SPECULAR) != 0) {
+            coefficients<FEATURES & MATERIAL_KS_MAP>(
+                packet, material->Ks_tex, material->Ks, lighting.ks);
+        } else {
+            coefficients<0>(packet, nullptr, Vec3(0.0f), lighting.ks);
+        }
+        lighting.shininess = material->Ns;
+        lighting.specular = (FEATURES & MATERIAL_SPECULAR) != 0;
+        lighting.ambient = 0.01f;
+        shadeBlinnPhongPacket(packet, lighting);
+    }
+    // a material color times its map if MAP is set
+    template <unsigned MAP>
+    static Vec3 coefficient(const RGBTexture* map, const Vec3& k, float u,
+                            float v) {
+        if constexpr (MAP != 0) {
+            return map->getBilinear(u, v).cwiseProduct(k);
+        } else {
+            return k;
+        }
+    }
+    // the same for every lane in the mask of a packet, the other lanes get k
+    template <unsigned MAP>
+    static void coefficients(const FragmentPacket& packet,
+                             const RGBTexture* map, const Vec3& k,
+                             float (&out)[3][SHADE_PACKET_SIZE]) {
+        for (int l = 0; l < SHADE_PACKET_SIZE; l++) {
+            Vec3 color = k;
+            if constexpr (MAP != 0) {
+                if (packet.mask >> l & 1u) {
+                    color = coefficient<MAP>(map, k, packet.texture_coord[0][l],
+                                             packet.texture_coord[1][l]);
+                }
+            }
+            out[0][l] = color.x;
+            out[1][l] = color.y;
+            out[2][l] = color.z;
+        }
+    }
+    template <size_t... FEATURES>
+    static constexpr std::array<RGBColor (*)(FragmentShaderPayload&),
+                                sizeof...(FEATURES)>
+    shadePermutations(std::index_sequence<FEATURES...>) {
+        return {{&shadeFeatures<unsigned(FEATURES)>...}};
+    }
+    template <size_t... FEATURES>
+    static constexpr std::array<void (*)(FragmentPacket&), sizeof...(FEATURES)>
+    packetPermutations(std::index_sequence<FEATURES...>) {
+        return {{&shadePacketFeatures<unsigned(FEATURES)>...}};
+    }
+    // after the permutation tables, they have to be defined to be evaluated
+    static RGBColor shade(FragmentShaderPayload& payload) {
+        static constexpr auto permutations = shadePermutations(
+            std::make_index_sequence<MATERIAL_FEATURE_COMBINATIONS>());
+        return permutations[payload.material->features](payload);
+    }
+    static void shadePacket(FragmentPacket& packet) {
+        static constexpr auto permutations = packetPermutations(
+            std::make_index_sequence<MATERIAL_FEATURE_COMBINATIONS>());
+        permutations[packet.material->features](packet);
+    }
+};
+// blinn-phong lit with a fixed white material
+struct BlinnPhongShader : FragmentShader<BlinnPhongShader> {
+    static RGBColor shade(FragmentShaderPayload& payload) {
+        RGBColor texture_color = RGBColor(1.0f);
+        // coefficients for ambient, diffuse and specular lighting
+        Vec3 ka = Vec3(0.005);
+        Vec3 kd = texture_color;
+        Vec3 ks = Vec3(0.7937);
+        float shiness = 150.0f;
+
+        const ShaderUniforms& uniforms = *payload.uniforms;
+        Vec3 eye_vec = (uniforms.eye_pos - payload.view_position).normalized();
+
+        Vec3 ambient_light_intensity(10);
+        RGBColor color;
+        for (auto& light : uniforms.lights) {
+            float light_point_dist_sq =
+                (light->position - payload.view_position).norm2();
+            Vec3 light_indensity = light->intensity / light_point_dist_sq;
+            Vec3 light_vec =
+                (light->position - payload.view_position).normalized();
+            Vec3 half_vec = (light_vec + eye_vec).normalized();
+
+            RGBColor ambient, diffuse, specular;
+            ambient = ambient_light_intensity.cwiseProduct(ka);
+            diffuse = kd.cwiseProduct(light_indensity) *
+                      std::max(0.0f, float(payload.normal.dot(
+                                         light_vec.normalized())));
+            // bling-phong specular shading model
+            // https://www.cnblogs.com/bluebean/p/5299358.html
+            specular =
+                ks.cwiseProduct(light_indensity) *
+                // negative fwd incident ray will be ignore
+                std::pow(std::max(payload.normal.dot(half_vec), 0.0f), shiness);
+            color = color + ambient + diffuse + specular;
+        }
+
+        return color.min(texture_color);
+    }
+    static void shadePacket(FragmentPacket& packet) {
+        BlinnPhongPacket lighting;
+        for (int c = 0; c < 3; c++) {
+            std::fill(std::begin(lighting.ka[c]), std::end(lighting.ka[c]),
+                      0.005f);
+            std::fill(std::begin(lighting.kd[c]), std::end(lighting.kd[c]),
+                      1.0f);
+            std::fill(std::begin(lighting.ks[c]), std::end(lighting.ks[c]),
+                      0.7937f);
+        }
+        lighting.shininess = 150.0f;
+        lighting.specular = true;
+        lighting.ambient = 10.0f;
+        shadeBlinnPhongPacket(packet, lighting);
+    }
+};
+// the diffuse texture without lighting
+struct TextureNoLightShader : FragmentShader<TextureNoLightShader> {
+    static RGBColor shade(FragmentShaderPayload& payload) {
+        if (!payload.material->Kd_tex) {
+            return RGBColor(1.0);
+        }
+        RGBColor texture_color = payload.material->Kd_tex->get(
+            payload.texture_coord.x, payload.texture_coord.y,
+            Rasterizer::TextureWrapMode::REPEAT);
+        // coefficients for ambient, diffuse and specular lighting
+        return texture_color;
+    }
+};
+
 RGBColor normalFragmentShader(FragmentShaderPayload& payload);
 RGBColor textureFragmentShader(FragmentShaderPayload& payload);
 RGBColor blingphongFragmentShader(FragmentShaderPayload& payload);
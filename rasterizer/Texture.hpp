@@ -1,6 +1,7 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 #include <iostream>
+#include <tuple>
 #include <vector>
 
 #include "lib/lodepng.h"
@@ -50,8 +51,8 @@ class Texture {
             v = math::clamp(v, 0.0f, 1.0f);
         } else if (mode == TextureWrapMode::REPEAT) {
             float _;
-            u = std::modff(u, &_);
-            v = std::modff(v, &_);
+            u = std::modf(u, &_);
+            v = std::modf(v, &_);
         }
         return std::make_tuple(u, v);
     }
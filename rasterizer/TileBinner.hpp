@@ -0,0 +1,83 @@
+#ifndef TILEBINNER_HPP
+#define TILEBINNER_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Rasterizer {
+// screen tile edge in pixels, a multiple of the framebuffer tile size
+static constexpr int BIN_TILE_SIZE = 64;
+
+// half open pixel rectangle [x0, x1) x [y0, y1)
+struct TileRect {
+    int x0, y0, x1, y1;
+};
+
+// sort-middle binning of screen space triangles into screen tiles
+// every thread owns a private set of bins, so binning needs no locks, and
+// as long as the triangles are split among threads in contiguous ascending
+// chunks, visiting the bins in thread order replays the submission order
+class TileBinner {
+   public:
+    int width, height;
+    int tiles_x, tiles_y;
+    // bins[thread][tile] lists the triangle ids overlapping the tile
+    std::vector<std::vector<std::vector<uint32_t>>> bins;
+
+    TileBinner() : width{0}, height{0}, tiles_x{0}, tiles_y{0} {}
+    // clear every bin for a new frame, the bins keep their capacity
+    void reset(int width, int height, int threads) {
+        this->width = width;
+        this->height = height;
+        tiles_x = (width + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+        tiles_y = (height + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+        bins.resize(threads);
+        for (auto& thread_bins : bins) {
+            thread_bins.resize(tileCount());
+            for (auto& bin : thread_bins) {
+                bin.clear();
+            }
+        }
+    }
+    int tileCount() const { return tiles_x * tiles_y; }
+    TileRect getTileRect(int tile) const {
+        int x0 = (tile % tiles_x) * BIN_TILE_SIZE,
+            y0 = (tile / tiles_x) * BIN_TILE_SIZE;
+        return {x0, y0, std::min(x0 + BIN_TILE_SIZE, width),
+                std::min(y0 + BIN_TILE_SIZE, height)};
+    }
+    // add a triangle to every tile its screen bounding box overlaps
+    void bin(int thread, uint32_t id, float xmin, float ymin, float xmax,
+             float ymax) {
+        xmin = std::max(std::floor(xmin), 0.0f);
+        ymin = std::max(std::floor(ymin), 0.0f);
+        xmax = std::min(std::ceil(xmax), float(width));
+        ymax = std::min(std::ceil(ymax), float(height));
+        // also rejects nan bounds
+        if (!(xmin < xmax && ymin < ymax)) {
+            return;
+        }
+        int tx0 = int(xmin) / BIN_TILE_SIZE, ty0 = int(ymin) / BIN_TILE_SIZE,
+            tx1 = (int(xmax) - 1) / BIN_TILE_SIZE,
+            ty1 = (int(ymax) - 1) / BIN_TILE_SIZE;
+        auto& thread_bins = bins[thread];
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                thread_bins[ty * tiles_x + tx].push_back(id);
+            }
+        }
+    }
+    // visit the triangles of a tile in submission order
+    template <typename F>
+    void forEachTriangle(int tile, F&& func) const {
+        for (const auto& thread_bins : bins) {
+            for (uint32_t id : thread_bins[tile]) {
+                func(id);
+            }
+        }
+    }
+};
+}  // namespace Rasterizer
+
+#endif /* TILEBINNER_HPP */
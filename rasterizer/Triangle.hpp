@@ -2,6 +2,8 @@
 #define TRIANGLE_HPP
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <tuple>
 
 #include "rasterizer/Math.hpp"
@@ -21,6 +23,34 @@ class Vertex {
           normal{normal},
           texture_coord{texture_coord} {}
 };
+// bit pattern of a float for exact comparisons and hashing, +0 and -0 are
+// the same
+inline uint32_t floatBits(float f) {
+    f = f == 0.0f ? 0.0f : f;
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+// fnv-1a over bit patterns
+template <size_t N>
+struct BitsHash {
+    size_t operator()(const std::array<uint32_t, N>& bits) const {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t v : bits) {
+            hash = (hash ^ v) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+// vertices with the same key are interchangeable
+inline std::array<uint32_t, 12> vertexKey(const Vertex& v) {
+    return {floatBits(v.coord.x),         floatBits(v.coord.y),
+            floatBits(v.coord.z),         floatBits(v.color.x),
+            floatBits(v.color.y),         floatBits(v.color.z),
+            floatBits(v.normal.x),        floatBits(v.normal.y),
+            floatBits(v.normal.z),        floatBits(v.texture_coord.x),
+            floatBits(v.texture_coord.y), floatBits(v.texture_coord.z)};
+}
 class Triangle {
    public:
     std::array<Vertex, 3> v;
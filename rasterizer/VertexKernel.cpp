@@ -0,0 +1,45 @@
+#include "rasterizer/VertexKernel.hpp"
+
+using namespace Rasterizer;
+void Rasterizer::transformVertexBlockScalar(const ModelTransform& transform,
+                                            VertexBlock& block) {
+    for (int l = 0; l < VERTEX_BLOCK_SIZE; l++) {
+        Vec4 position(block.position[0][l], block.position[1][l],
+                      block.position[2][l], 1.0f);
+        Vec4 normal(block.normal[0][l], block.normal[1][l],
+                    block.normal[2][l], 0.0f);
+        Vec4 clip = transform.mvp * position,
+             view_pos = transform.view_model * position,
+             world_pos = transform.model * position,
+             view_normal = transform.normal * normal;
+        block.clip[0][l] = clip.x;
+        block.clip[1][l] = clip.y;
+        block.clip[2][l] = clip.z;
+        block.clip[3][l] = clip.w;
+        block.view_pos[0][l] = view_pos.x;
+        block.view_pos[1][l] = view_pos.y;
+        block.view_pos[2][l] = view_pos.z;
+        block.world_pos[0][l] = world_pos.x;
+        block.world_pos[1][l] = world_pos.y;
+        block.world_pos[2][l] = world_pos.z;
+        block.view_normal[0][l] = view_normal.x;
+        block.view_normal[1][l] = view_normal.y;
+        block.view_normal[2][l] = view_normal.z;
+    }
+}
+
+#ifndef OPT_NEON
+void Rasterizer::transformVertexBlock(const ModelTransform& transform,
+                                      VertexBlock& block) {
+#ifdef OPT_SSE
+    // the widest kernel the cpu runs, picked on the first call
+    static void (*const kernel)(const ModelTransform&, VertexBlock&) =
+        cpuSupportsAVX2()    ? transformVertexBlockAVX2
+        : cpuSupportsSSE41() ? transformVertexBlockSSE
+                             : transformVertexBlockScalar;
+    kernel(transform, block);
+#else
+    transformVertexBlockScalar(transform, block);
+#endif
+}
+#endif
@@ -0,0 +1,87 @@
+#ifndef VERTEXKERNEL_HPP
+#define VERTEXKERNEL_HPP
+#include <array>
+#include <vector>
+
+#include "rasterizer/Math.hpp"
+#include "rasterizer/Triangle.hpp"
+namespace Rasterizer {
+// vertices processed by one kernel invocation, one AVX2 register
+static constexpr int VERTEX_BLOCK_SIZE = 8;
+
+// the matrices of a model for one frame
+struct ModelTransform {
+    Mat4 model;
+    Mat4 view_model;
+    // transforms normals into view space
+    Mat4 normal;
+    Mat4 mvp;
+};
+
+// the vertices of a mesh as one array per component, so the vertex stage
+// loads a component of a whole block at once, every array is padded to a
+// multiple of VERTEX_BLOCK_SIZE
+struct VertexStreams {
+    std::array<std::vector<float>, 3> position;
+    std::array<std::vector<float>, 3> normal;
+    std::array<std::vector<float>, 2> texture_coord;
+    size_t count = 0;
+    void assign(const std::vector<Vertex>& vertices) {
+        count = vertices.size();
+        size_t padded = (count + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE *
+                        VERTEX_BLOCK_SIZE;
+        for (auto* streams : {&position, &normal}) {
+            for (auto& stream : *streams) {
+                stream.assign(padded, 0.0f);
+            }
+        }
+        for (auto& stream : texture_coord) {
+            stream.assign(padded, 0.0f);
+        }
+        for (size_t v = 0; v < count; v++) {
+            const Vertex& vertex = vertices[v];
+            position[0][v] = vertex.coord.x;
+            position[1][v] = vertex.coord.y;
+            position[2][v] = vertex.coord.z;
+            normal[0][v] = vertex.normal.x;
+            normal[1][v] = vertex.normal.y;
+            normal[2][v] = vertex.normal.z;
+            texture_coord[0][v] = vertex.texture_coord.x;
+            texture_coord[1][v] = vertex.texture_coord.y;
+        }
+    }
+};
+
+// VERTEX_BLOCK_SIZE consecutive vertices of one mesh
+struct VertexBlock {
+    // in: the streams from the first vertex of the block on
+    const float* position[3];
+    const float* normal[3];
+    // out: clip, view and world space positions
+    alignas(32) float clip[4][VERTEX_BLOCK_SIZE];
+    alignas(32) float view_pos[3][VERTEX_BLOCK_SIZE];
+    alignas(32) float world_pos[3][VERTEX_BLOCK_SIZE];
+    // out: view space normal, not normalized
+    alignas(32) float view_normal[3][VERTEX_BLOCK_SIZE];
+};
+
+// transform the positions and normals of a block by the matrices of its
+// model
+void transformVertexBlock(const ModelTransform& transform, VertexBlock& block);
+// portable reference implementation
+void transformVertexBlockScalar(const ModelTransform& transform,
+                                VertexBlock& block);
+#ifdef OPT_SSE
+void transformVertexBlockSSE(const ModelTransform& transform,
+                             VertexBlock& block);
+#endif
+#ifdef OPT_AVX2
+void transformVertexBlockAVX2(const ModelTransform& transform,
+                              VertexBlock& block);
+#endif
+#ifdef OPT_NEON
+void transformVertexBlockNeon(const ModelTransform& transform,
+                              VertexBlock& block);
+#endif
+}  // namespace Rasterizer
+#endif /* VERTEXKERNEL_HPP */
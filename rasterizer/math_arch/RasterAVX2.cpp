@@ -0,0 +1,58 @@
+#include "rasterizer/RasterKernel.hpp"
+#ifdef OPT_AVX2
+#include <immintrin.h>
+using namespace Rasterizer;
+
+void Rasterizer::rasterizeBlockAVX2(RasterBlock& block) {
+    const __m256 lane =
+        _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256i lane_i = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    // a lane is covered if no edge value has its sign bit set
+    __m256i ie0 = _mm256_add_epi32(
+                _mm256_set1_epi32(block.ie[0]),
+                _mm256_mullo_epi32(_mm256_set1_epi32(block.ide[0]), lane_i)),
+            ie1 = _mm256_add_epi32(
+                _mm256_set1_epi32(block.ie[1]),
+                _mm256_mullo_epi32(_mm256_set1_epi32(block.ide[1]), lane_i)),
+            ie2 = _mm256_add_epi32(
+                _mm256_set1_epi32(block.ie[2]),
+                _mm256_mullo_epi32(_mm256_set1_epi32(block.ide[2]), lane_i));
+    __m256i inside = _mm256_cmpgt_epi32(
+        _mm256_or_si256(ie0, _mm256_or_si256(ie1, ie2)),
+        _mm256_set1_epi32(-1));
+    __m256 covered = _mm256_and_ps(
+        _mm256_cmp_ps(lane, _mm256_set1_ps(float(block.lanes)), _CMP_LT_OQ),
+        _mm256_castsi256_ps(inside));
+    if (_mm256_movemask_ps(covered) == 0) {
+        block.mask = 0;
+        return;
+    }
+    __m256 e0 = _mm256_add_ps(_mm256_set1_ps(block.e[0]),
+                              _mm256_mul_ps(_mm256_set1_ps(block.de[0]), lane)),
+           e1 = _mm256_add_ps(_mm256_set1_ps(block.e[1]),
+                              _mm256_mul_ps(_mm256_set1_ps(block.de[1]), lane)),
+           e2 = _mm256_add_ps(_mm256_set1_ps(block.e[2]),
+                              _mm256_mul_ps(_mm256_set1_ps(block.de[2]), lane));
+    const __m256 inv_area = _mm256_set1_ps(block.inv_area);
+    __m256 alpha = _mm256_mul_ps(e0, inv_area),
+           beta = _mm256_mul_ps(e1, inv_area),
+           gamma = _mm256_mul_ps(e2, inv_area);
+    __m256 pa = _mm256_mul_ps(alpha, _mm256_set1_ps(block.inv_w[0])),
+           pb = _mm256_mul_ps(beta, _mm256_set1_ps(block.inv_w[1])),
+           pg = _mm256_mul_ps(gamma, _mm256_set1_ps(block.inv_w[2]));
+    __m256 Z = _mm256_div_ps(_mm256_set1_ps(1.0f),
+                             _mm256_add_ps(_mm256_add_ps(pa, pb), pg));
+    __m256 depth = _mm256_load_ps(block.depth);
+    __m256 pass =
+        _mm256_and_ps(covered, _mm256_cmp_ps(Z, depth, _CMP_GT_OQ));
+    _mm256_store_ps(block.depth, _mm256_blendv_ps(depth, Z, pass));
+    _mm256_store_ps(block.z, Z);
+    _mm256_store_ps(block.bary[0], alpha);
+    _mm256_store_ps(block.bary[1], beta);
+    _mm256_store_ps(block.bary[2], gamma);
+    _mm256_store_ps(block.persp[0], _mm256_mul_ps(pa, Z));
+    _mm256_store_ps(block.persp[1], _mm256_mul_ps(pb, Z));
+    _mm256_store_ps(block.persp[2], _mm256_mul_ps(pg, Z));
+    block.mask = unsigned(_mm256_movemask_ps(pass));
+}
+#endif
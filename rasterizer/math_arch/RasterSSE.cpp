@@ -0,0 +1,64 @@
+#include "rasterizer/RasterKernel.hpp"
+#ifdef OPT_SSE
+#include <immintrin.h>
+using namespace Rasterizer;
+
+// evaluate 4 lanes starting at lane `base`, returns the lane mask
+static inline unsigned rasterizeQuadSSE(RasterBlock& block, int base) {
+    const __m128 lane = _mm_add_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f),
+                                   _mm_set1_ps(float(base)));
+    const __m128i lane_i =
+        _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(base));
+    // a lane is covered if no edge value has its sign bit set
+    __m128i ie0 = _mm_add_epi32(_mm_set1_epi32(block.ie[0]),
+                                _mm_mullo_epi32(_mm_set1_epi32(block.ide[0]),
+                                                lane_i)),
+            ie1 = _mm_add_epi32(_mm_set1_epi32(block.ie[1]),
+                                _mm_mullo_epi32(_mm_set1_epi32(block.ide[1]),
+                                                lane_i)),
+            ie2 = _mm_add_epi32(_mm_set1_epi32(block.ie[2]),
+                                _mm_mullo_epi32(_mm_set1_epi32(block.ide[2]),
+                                                lane_i));
+    __m128i inside =
+        _mm_cmpgt_epi32(_mm_or_si128(ie0, _mm_or_si128(ie1, ie2)),
+                        _mm_set1_epi32(-1));
+    __m128 covered =
+        _mm_and_ps(_mm_cmplt_ps(lane, _mm_set1_ps(float(block.lanes))),
+                   _mm_castsi128_ps(inside));
+    if (_mm_movemask_ps(covered) == 0) {
+        return 0;
+    }
+    __m128 e0 = _mm_add_ps(_mm_set1_ps(block.e[0]),
+                           _mm_mul_ps(_mm_set1_ps(block.de[0]), lane)),
+           e1 = _mm_add_ps(_mm_set1_ps(block.e[1]),
+                           _mm_mul_ps(_mm_set1_ps(block.de[1]), lane)),
+           e2 = _mm_add_ps(_mm_set1_ps(block.e[2]),
+                           _mm_mul_ps(_mm_set1_ps(block.de[2]), lane));
+    const __m128 inv_area = _mm_set1_ps(block.inv_area);
+    __m128 alpha = _mm_mul_ps(e0, inv_area), beta = _mm_mul_ps(e1, inv_area),
+           gamma = _mm_mul_ps(e2, inv_area);
+    __m128 pa = _mm_mul_ps(alpha, _mm_set1_ps(block.inv_w[0])),
+           pb = _mm_mul_ps(beta, _mm_set1_ps(block.inv_w[1])),
+           pg = _mm_mul_ps(gamma, _mm_set1_ps(block.inv_w[2]));
+    __m128 Z = _mm_div_ps(_mm_set1_ps(1.0f),
+                          _mm_add_ps(_mm_add_ps(pa, pb), pg));
+    __m128 depth = _mm_load_ps(block.depth + base);
+    __m128 pass = _mm_and_ps(covered, _mm_cmpgt_ps(Z, depth));
+    _mm_store_ps(block.depth + base, _mm_blendv_ps(depth, Z, pass));
+    _mm_store_ps(block.z + base, Z);
+    _mm_store_ps(block.bary[0] + base, alpha);
+    _mm_store_ps(block.bary[1] + base, beta);
+    _mm_store_ps(block.bary[2] + base, gamma);
+    _mm_store_ps(block.persp[0] + base, _mm_mul_ps(pa, Z));
+    _mm_store_ps(block.persp[1] + base, _mm_mul_ps(pb, Z));
+    _mm_store_ps(block.persp[2] + base, _mm_mul_ps(pg, Z));
+    return unsigned(_mm_movemask_ps(pass)) << base;
+}
+
+void Rasterizer::rasterizeBlockSSE(RasterBlock& block) {
+    block.mask = rasterizeQuadSSE(block, 0);
+    if (block.lanes > 4) {
+        block.mask |= rasterizeQuadSSE(block, 4);
+    }
+}
+#endif
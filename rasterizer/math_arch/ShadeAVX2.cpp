@@ -0,0 +1,117 @@
+#include "rasterizer/ShadeKernel.hpp"
+#ifdef OPT_AVX2
+#include <immintrin.h>
+
+using namespace Rasterizer;
+
+static inline __m256 dotAVX2(const __m256 (&a)[3], const __m256 (&b)[3]) {
+    return _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])),
+        _mm256_mul_ps(a[2], b[2]));
+}
+// specularPow() of 8 lanes
+static inline __m256 specularPowAVX2(__m256 x, __m256 n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256i bits = _mm256_castps_si256(
+        _mm256_max_ps(x, _mm256_set1_ps(1.17549435e-38f)));
+    __m256i e =
+        _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+        _mm256_set1_epi32(0x3f800000)));
+    __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one)),
+           t2 = _mm256_mul_ps(t, t);
+    __m256 poly = _mm256_add_ps(_mm256_set1_ps(LOG2_C5),
+                                _mm256_mul_ps(t2, _mm256_set1_ps(LOG2_C7)));
+    poly = _mm256_add_ps(_mm256_set1_ps(LOG2_C3), _mm256_mul_ps(t2, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(LOG2_C1), _mm256_mul_ps(t2, poly));
+    __m256 log2_x = _mm256_add_ps(
+        _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_and_ps(big, one)),
+        _mm256_mul_ps(t, poly));
+    __m256 y = _mm256_mul_ps(n, log2_x);
+    __m256 i =
+        _mm256_round_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 f = _mm256_sub_ps(y, i);
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(EXP2_C5),
+                             _mm256_mul_ps(f, _mm256_set1_ps(EXP2_C6)));
+    p = _mm256_add_ps(_mm256_set1_ps(EXP2_C4), _mm256_mul_ps(f, p));
+    p = _mm256_add_ps(_mm256_set1_ps(EXP2_C3), _mm256_mul_ps(f, p));
+    p = _mm256_add_ps(_mm256_set1_ps(EXP2_C2), _mm256_mul_ps(f, p));
+    p = _mm256_add_ps(_mm256_set1_ps(EXP2_C1), _mm256_mul_ps(f, p));
+    p = _mm256_add_ps(one, _mm256_mul_ps(f, p));
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvtps_epi32(i), _mm256_set1_epi32(127)), 23));
+    __m256 underflow =
+        _mm256_cmp_ps(y, _mm256_set1_ps(-126.0f), _CMP_LT_OQ);
+    return _mm256_andnot_ps(underflow, _mm256_mul_ps(p, scale));
+}
+static inline void normalizeAVX2(__m256 (&v)[3]) {
+    __m256 inv =
+        _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(dotAVX2(v, v)));
+    for (int c = 0; c < 3; c++) {
+        v[c] = _mm256_mul_ps(v[c], inv);
+    }
+}
+
+void Rasterizer::shadeBlinnPhongAVX2(BlinnPhongPacket& packet) {
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const float eye[3] = {packet.eye_pos.x, packet.eye_pos.y,
+                          packet.eye_pos.z};
+    __m256 normal[3], position[3], eye_vec[3], ambient[3], kd[3], ks[3],
+        color[3];
+    for (int c = 0; c < 3; c++) {
+        normal[c] = _mm256_load_ps(packet.normal[c]);
+        position[c] = _mm256_load_ps(packet.position[c]);
+        eye_vec[c] = _mm256_sub_ps(_mm256_set1_ps(eye[c]), position[c]);
+        ambient[c] = _mm256_mul_ps(_mm256_set1_ps(packet.ambient),
+                                   _mm256_load_ps(packet.ka[c]));
+        kd[c] = _mm256_load_ps(packet.kd[c]);
+        ks[c] = _mm256_load_ps(packet.ks[c]);
+        color[c] = zero;
+    }
+    normalizeAVX2(eye_vec);
+    for (size_t i = 0; i < packet.light_count; i++) {
+        const Light* light = packet.lights[i];
+        const float light_position[3] = {light->position.x, light->position.y,
+                                         light->position.z};
+        const float intensity[3] = {light->intensity.x, light->intensity.y,
+                                    light->intensity.z};
+        __m256 light_vec[3];
+        for (int c = 0; c < 3; c++) {
+            light_vec[c] =
+                _mm256_sub_ps(_mm256_set1_ps(light_position[c]), position[c]);
+        }
+        __m256 inv_dist_sq =
+            _mm256_div_ps(one, dotAVX2(light_vec, light_vec));
+        normalizeAVX2(light_vec);
+        __m256 spec = zero;
+        if (packet.specular) {
+            __m256 half_vec[3] = {_mm256_add_ps(light_vec[0], eye_vec[0]),
+                                  _mm256_add_ps(light_vec[1], eye_vec[1]),
+                                  _mm256_add_ps(light_vec[2], eye_vec[2])};
+            normalizeAVX2(half_vec);
+            spec = specularPowAVX2(
+                _mm256_max_ps(dotAVX2(normal, half_vec), zero),
+                _mm256_set1_ps(packet.shininess));
+        }
+        // the scalar shader normalizes the light vector a second time
+        normalizeAVX2(light_vec);
+        __m256 diffuse = _mm256_max_ps(dotAVX2(normal, light_vec), zero);
+        for (int c = 0; c < 3; c++) {
+            __m256 light_intensity =
+                _mm256_mul_ps(_mm256_set1_ps(intensity[c]), inv_dist_sq);
+            color[c] = _mm256_add_ps(
+                _mm256_add_ps(_mm256_add_ps(color[c], ambient[c]),
+                              _mm256_mul_ps(_mm256_mul_ps(kd[c],
+                                                          light_intensity),
+                                            diffuse)),
+                _mm256_mul_ps(_mm256_mul_ps(ks[c], light_intensity), spec));
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        _mm256_store_ps(packet.color[c], _mm256_min_ps(color[c], one));
+    }
+}
+#endif
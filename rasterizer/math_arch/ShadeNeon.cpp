@@ -0,0 +1,124 @@
+#include "rasterizer/ShadeKernel.hpp"
+#ifdef OPT_NEON
+#include <arm_neon.h>
+
+using namespace Rasterizer;
+
+static inline float32x4_t dotNeon(const float32x4_t (&a)[3],
+                                  const float32x4_t (&b)[3]) {
+    return vaddq_f32(vaddq_f32(vmulq_f32(a[0], b[0]), vmulq_f32(a[1], b[1])),
+                     vmulq_f32(a[2], b[2]));
+}
+// v times the reciprocal of its length, like Vec3::normalized()
+static inline void normalizeNeon(float32x4_t (&v)[3]) {
+    float32x4_t inv = vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(dotNeon(v, v)));
+    for (int c = 0; c < 3; c++) {
+        v[c] = vmulq_f32(v[c], inv);
+    }
+}
+// specularPow() of 4 lanes
+static inline float32x4_t specularPowNeon(float32x4_t x, float32x4_t n) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    uint32x4_t bits =
+        vreinterpretq_u32_f32(vmaxq_f32(x, vdupq_n_f32(1.17549435e-38f)));
+    int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)),
+                            vdupq_n_s32(127));
+    float32x4_t m = vreinterpretq_f32_u32(
+        vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)),
+                  vdupq_n_u32(0x3f800000)));
+    uint32x4_t big = vcgtq_f32(m, vdupq_n_f32(1.41421356f));
+    m = vbslq_f32(big, vmulq_n_f32(m, 0.5f), m);
+    float32x4_t t = vdivq_f32(vsubq_f32(m, one), vaddq_f32(m, one)),
+                t2 = vmulq_f32(t, t);
+    float32x4_t poly = vaddq_f32(vdupq_n_f32(LOG2_C5),
+                                 vmulq_n_f32(t2, LOG2_C7));
+    poly = vaddq_f32(vdupq_n_f32(LOG2_C3), vmulq_f32(t2, poly));
+    poly = vaddq_f32(vdupq_n_f32(LOG2_C1), vmulq_f32(t2, poly));
+    float32x4_t e_f = vaddq_f32(
+        vcvtq_f32_s32(e),
+        vreinterpretq_f32_u32(vandq_u32(big, vreinterpretq_u32_f32(one))));
+    float32x4_t log2_x = vaddq_f32(e_f, vmulq_f32(t, poly));
+    float32x4_t y = vmulq_f32(n, log2_x);
+    float32x4_t i = vrndnq_f32(y);
+    float32x4_t f = vsubq_f32(y, i);
+    float32x4_t p = vaddq_f32(vdupq_n_f32(EXP2_C5), vmulq_n_f32(f, EXP2_C6));
+    p = vaddq_f32(vdupq_n_f32(EXP2_C4), vmulq_f32(f, p));
+    p = vaddq_f32(vdupq_n_f32(EXP2_C3), vmulq_f32(f, p));
+    p = vaddq_f32(vdupq_n_f32(EXP2_C2), vmulq_f32(f, p));
+    p = vaddq_f32(vdupq_n_f32(EXP2_C1), vmulq_f32(f, p));
+    p = vaddq_f32(one, vmulq_f32(f, p));
+    float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(
+        vaddq_s32(vcvtq_s32_f32(i), vdupq_n_s32(127)), 23));
+    uint32x4_t underflow = vcltq_f32(y, vdupq_n_f32(-126.0f));
+    return vreinterpretq_f32_u32(vbicq_u32(
+        vreinterpretq_u32_f32(vmulq_f32(p, scale)), underflow));
+}
+// light 4 lanes starting at lane `base`
+static inline void shadeQuadNeon(BlinnPhongPacket& packet, int base) {
+    const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+    const float eye[3] = {packet.eye_pos.x, packet.eye_pos.y,
+                          packet.eye_pos.z};
+    float32x4_t normal[3], position[3], eye_vec[3], ambient[3], kd[3], ks[3],
+        color[3];
+    for (int c = 0; c < 3; c++) {
+        normal[c] = vld1q_f32(packet.normal[c] + base);
+        position[c] = vld1q_f32(packet.position[c] + base);
+        eye_vec[c] = vsubq_f32(vdupq_n_f32(eye[c]), position[c]);
+        ambient[c] = vmulq_n_f32(vld1q_f32(packet.ka[c] + base),
+                                 packet.ambient);
+        kd[c] = vld1q_f32(packet.kd[c] + base);
+        ks[c] = vld1q_f32(packet.ks[c] + base);
+        color[c] = zero;
+    }
+    normalizeNeon(eye_vec);
+    for (size_t i = 0; i < packet.light_count; i++) {
+        const Light* light = packet.lights[i];
+        const float light_position[3] = {light->position.x, light->position.y,
+                                         light->position.z};
+        const float intensity[3] = {light->intensity.x, light->intensity.y,
+                                    light->intensity.z};
+        float32x4_t light_vec[3];
+        for (int c = 0; c < 3; c++) {
+            light_vec[c] =
+                vsubq_f32(vdupq_n_f32(light_position[c]), position[c]);
+        }
+        float32x4_t inv_dist_sq =
+            vdivq_f32(one, dotNeon(light_vec, light_vec));
+        normalizeNeon(light_vec);
+        float32x4_t spec = zero;
+        if (packet.specular) {
+            float32x4_t half_vec[3] = {vaddq_f32(light_vec[0], eye_vec[0]),
+                                       vaddq_f32(light_vec[1], eye_vec[1]),
+                                       vaddq_f32(light_vec[2], eye_vec[2])};
+            normalizeNeon(half_vec);
+            spec = specularPowNeon(vmaxq_f32(dotNeon(normal, half_vec), zero),
+                                   vdupq_n_f32(packet.shininess));
+        }
+        // the scalar shader normalizes the light vector a second time
+        normalizeNeon(light_vec);
+        float32x4_t diffuse = vmaxq_f32(dotNeon(normal, light_vec), zero);
+        for (int c = 0; c < 3; c++) {
+            float32x4_t light_intensity =
+                vmulq_n_f32(inv_dist_sq, intensity[c]);
+            color[c] = vaddq_f32(
+                vaddq_f32(vaddq_f32(color[c], ambient[c]),
+                          vmulq_f32(vmulq_f32(kd[c], light_intensity),
+                                    diffuse)),
+                vmulq_f32(vmulq_f32(ks[c], light_intensity), spec));
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        vst1q_f32(packet.color[c] + base, vminq_f32(color[c], one));
+    }
+}
+
+void Rasterizer::shadeBlinnPhongNeon(BlinnPhongPacket& packet) {
+    for (int base = 0; base < SHADE_PACKET_SIZE; base += 4) {
+        shadeQuadNeon(packet, base);
+    }
+}
+
+void Rasterizer::shadeBlinnPhong(BlinnPhongPacket& packet) {
+    shadeBlinnPhongNeon(packet);
+}
+#endif
@@ -0,0 +1,117 @@
+#include "rasterizer/ShadeKernel.hpp"
+#ifdef OPT_SSE
+#include <immintrin.h>
+
+using namespace Rasterizer;
+
+static inline __m128 dotSSE(const __m128 (&a)[3], const __m128 (&b)[3]) {
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+        _mm_mul_ps(a[2], b[2]));
+}
+// v times the reciprocal of its length, like Vec3::normalized()
+static inline void normalizeSSE(__m128 (&v)[3]) {
+    __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dotSSE(v, v)));
+    for (int c = 0; c < 3; c++) {
+        v[c] = _mm_mul_ps(v[c], inv);
+    }
+}
+// specularPow() of 4 lanes
+static inline __m128 specularPowSSE(__m128 x, __m128 n) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i bits =
+        _mm_castps_si128(_mm_max_ps(x, _mm_set1_ps(1.17549435e-38f)));
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(
+        _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                     _mm_set1_epi32(0x3f800000)));
+    __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_blendv_ps(m, _mm_mul_ps(m, _mm_set1_ps(0.5f)), big);
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one)),
+           t2 = _mm_mul_ps(t, t);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(LOG2_C5),
+                             _mm_mul_ps(t2, _mm_set1_ps(LOG2_C7)));
+    poly = _mm_add_ps(_mm_set1_ps(LOG2_C3), _mm_mul_ps(t2, poly));
+    poly = _mm_add_ps(_mm_set1_ps(LOG2_C1), _mm_mul_ps(t2, poly));
+    __m128 log2_x =
+        _mm_add_ps(_mm_add_ps(_mm_cvtepi32_ps(e), _mm_and_ps(big, one)),
+                   _mm_mul_ps(t, poly));
+    __m128 y = _mm_mul_ps(n, log2_x);
+    __m128 i = _mm_round_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m128 f = _mm_sub_ps(y, i);
+    __m128 p = _mm_add_ps(_mm_set1_ps(EXP2_C5),
+                          _mm_mul_ps(f, _mm_set1_ps(EXP2_C6)));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C4), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C3), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C2), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C1), _mm_mul_ps(f, p));
+    p = _mm_add_ps(one, _mm_mul_ps(f, p));
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_add_epi32(_mm_cvtps_epi32(i), _mm_set1_epi32(127)), 23));
+    __m128 underflow = _mm_cmplt_ps(y, _mm_set1_ps(-126.0f));
+    return _mm_andnot_ps(underflow, _mm_mul_ps(p, scale));
+}
+// light 4 lanes starting at lane `base`
+static inline void shadeQuadSSE(BlinnPhongPacket& packet, int base) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const float eye[3] = {packet.eye_pos.x, packet.eye_pos.y,
+                          packet.eye_pos.z};
+    __m128 normal[3], position[3], eye_vec[3], ambient[3], kd[3], ks[3],
+        color[3];
+    for (int c = 0; c < 3; c++) {
+        normal[c] = _mm_load_ps(packet.normal[c] + base);
+        position[c] = _mm_load_ps(packet.position[c] + base);
+        eye_vec[c] = _mm_sub_ps(_mm_set1_ps(eye[c]), position[c]);
+        ambient[c] = _mm_mul_ps(_mm_set1_ps(packet.ambient),
+                                _mm_load_ps(packet.ka[c] + base));
+        kd[c] = _mm_load_ps(packet.kd[c] + base);
+        ks[c] = _mm_load_ps(packet.ks[c] + base);
+        color[c] = zero;
+    }
+    normalizeSSE(eye_vec);
+    for (size_t i = 0; i < packet.light_count; i++) {
+        const Light* light = packet.lights[i];
+        const float light_position[3] = {light->position.x, light->position.y,
+                                         light->position.z};
+        const float intensity[3] = {light->intensity.x, light->intensity.y,
+                                    light->intensity.z};
+        __m128 light_vec[3];
+        for (int c = 0; c < 3; c++) {
+            light_vec[c] =
+                _mm_sub_ps(_mm_set1_ps(light_position[c]), position[c]);
+        }
+        __m128 inv_dist_sq = _mm_div_ps(one, dotSSE(light_vec, light_vec));
+        normalizeSSE(light_vec);
+        __m128 spec = zero;
+        if (packet.specular) {
+            __m128 half_vec[3] = {_mm_add_ps(light_vec[0], eye_vec[0]),
+                                  _mm_add_ps(light_vec[1], eye_vec[1]),
+                                  _mm_add_ps(light_vec[2], eye_vec[2])};
+            normalizeSSE(half_vec);
+            spec = specularPowSSE(_mm_max_ps(dotSSE(normal, half_vec), zero),
+                                  _mm_set1_ps(packet.shininess));
+        }
+        // the scalar shader normalizes the light vector a second time
+        normalizeSSE(light_vec);
+        __m128 diffuse = _mm_max_ps(dotSSE(normal, light_vec), zero);
+        for (int c = 0; c < 3; c++) {
+            __m128 light_intensity =
+                _mm_mul_ps(_mm_set1_ps(intensity[c]), inv_dist_sq);
+            color[c] = _mm_add_ps(
+                _mm_add_ps(_mm_add_ps(color[c], ambient[c]),
+                           _mm_mul_ps(_mm_mul_ps(kd[c], light_intensity),
+                                      diffuse)),
+                _mm_mul_ps(_mm_mul_ps(ks[c], light_intensity), spec));
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        _mm_store_ps(packet.color[c] + base, _mm_min_ps(color[c], one));
+    }
+}
+
+void Rasterizer::shadeBlinnPhongSSE(BlinnPhongPacket& packet) {
+    for (int base = 0; base < SHADE_PACKET_SIZE; base += 4) {
+        shadeQuadSSE(packet, base);
+    }
+}
+#endif
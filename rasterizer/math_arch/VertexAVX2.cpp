@@ -0,0 +1,35 @@
+#include "rasterizer/VertexKernel.hpp"
+#ifdef OPT_AVX2
+#include <immintrin.h>
+using namespace Rasterizer;
+
+static inline void transformBlockAVX2(const Mat4& mat, int rows, __m256 x,
+                                      __m256 y, __m256 z, bool point,
+                                      float (*out)[VERTEX_BLOCK_SIZE]) {
+    for (int r = 0; r < rows; r++) {
+        __m256 v = _mm256_mul_ps(_mm256_set1_ps(mat.m[r][0]), x);
+        v = _mm256_fmadd_ps(_mm256_set1_ps(mat.m[r][1]), y, v);
+        v = _mm256_fmadd_ps(_mm256_set1_ps(mat.m[r][2]), z, v);
+        if (point) {
+            v = _mm256_add_ps(v, _mm256_set1_ps(mat.m[r][3]));
+        }
+        _mm256_store_ps(out[r], v);
+    }
+}
+
+void Rasterizer::transformVertexBlockAVX2(const ModelTransform& transform,
+                                          VertexBlock& block) {
+    __m256 px = _mm256_loadu_ps(block.position[0]),
+           py = _mm256_loadu_ps(block.position[1]),
+           pz = _mm256_loadu_ps(block.position[2]);
+    transformBlockAVX2(transform.mvp, 4, px, py, pz, true, block.clip);
+    transformBlockAVX2(transform.view_model, 3, px, py, pz, true,
+                       block.view_pos);
+    transformBlockAVX2(transform.model, 3, px, py, pz, true,
+                       block.world_pos);
+    transformBlockAVX2(transform.normal, 3, _mm256_loadu_ps(block.normal[0]),
+                       _mm256_loadu_ps(block.normal[1]),
+                       _mm256_loadu_ps(block.normal[2]), false,
+                       block.view_normal);
+}
+#endif
@@ -0,0 +1,48 @@
+#include "rasterizer/VertexKernel.hpp"
+#ifdef OPT_NEON
+#include <arm_neon.h>
+using namespace Rasterizer;
+
+// the first rows of mat times 4 lanes of (x, y, z, w), w is 1 for points
+// and 0 for directions
+static inline void transformQuadNeon(const Mat4& mat, int rows,
+                                     float32x4_t x, float32x4_t y,
+                                     float32x4_t z, bool point,
+                                     float (*out)[VERTEX_BLOCK_SIZE],
+                                     int base) {
+    for (int r = 0; r < rows; r++) {
+        float32x4_t v = vmulq_n_f32(x, mat.m[r][0]);
+        v = vfmaq_n_f32(v, y, mat.m[r][1]);
+        v = vfmaq_n_f32(v, z, mat.m[r][2]);
+        if (point) {
+            v = vaddq_f32(v, vdupq_n_f32(mat.m[r][3]));
+        }
+        vst1q_f32(out[r] + base, v);
+    }
+}
+
+void Rasterizer::transformVertexBlockNeon(const ModelTransform& transform,
+                                          VertexBlock& block) {
+    for (int base = 0; base < VERTEX_BLOCK_SIZE; base += 4) {
+        float32x4_t px = vld1q_f32(block.position[0] + base),
+                    py = vld1q_f32(block.position[1] + base),
+                    pz = vld1q_f32(block.position[2] + base);
+        transformQuadNeon(transform.mvp, 4, px, py, pz, true, block.clip,
+                          base);
+        transformQuadNeon(transform.view_model, 3, px, py, pz, true,
+                          block.view_pos, base);
+        transformQuadNeon(transform.model, 3, px, py, pz, true,
+                          block.world_pos, base);
+        transformQuadNeon(transform.normal, 3,
+                          vld1q_f32(block.normal[0] + base),
+                          vld1q_f32(block.normal[1] + base),
+                          vld1q_f32(block.normal[2] + base), false,
+                          block.view_normal, base);
+    }
+}
+
+void Rasterizer::transformVertexBlock(const ModelTransform& transform,
+                                      VertexBlock& block) {
+    transformVertexBlockNeon(transform, block);
+}
+#endif
@@ -0,0 +1,43 @@
+#include "rasterizer/VertexKernel.hpp"
+#ifdef OPT_SSE
+#include <immintrin.h>
+using namespace Rasterizer;
+
+// the first rows of mat times 4 lanes of (x, y, z, w), w is 1 for points
+// and 0 for directions
+static inline void transformQuadSSE(const Mat4& mat, int rows, __m128 x,
+                                    __m128 y, __m128 z, bool point,
+                                    float (*out)[VERTEX_BLOCK_SIZE],
+                                    int base) {
+    for (int r = 0; r < rows; r++) {
+        __m128 v = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat.m[r][0]), x),
+                       _mm_mul_ps(_mm_set1_ps(mat.m[r][1]), y)),
+            _mm_mul_ps(_mm_set1_ps(mat.m[r][2]), z));
+        if (point) {
+            v = _mm_add_ps(v, _mm_set1_ps(mat.m[r][3]));
+        }
+        _mm_store_ps(out[r] + base, v);
+    }
+}
+
+void Rasterizer::transformVertexBlockSSE(const ModelTransform& transform,
+                                         VertexBlock& block) {
+    for (int base = 0; base < VERTEX_BLOCK_SIZE; base += 4) {
+        __m128 px = _mm_loadu_ps(block.position[0] + base),
+               py = _mm_loadu_ps(block.position[1] + base),
+               pz = _mm_loadu_ps(block.position[2] + base);
+        transformQuadSSE(transform.mvp, 4, px, py, pz, true, block.clip,
+                         base);
+        transformQuadSSE(transform.view_model, 3, px, py, pz, true,
+                         block.view_pos, base);
+        transformQuadSSE(transform.model, 3, px, py, pz, true,
+                         block.world_pos, base);
+        transformQuadSSE(transform.normal, 3,
+                         _mm_loadu_ps(block.normal[0] + base),
+                         _mm_loadu_ps(block.normal[1] + base),
+                         _mm_loadu_ps(block.normal[2] + base), false,
+                         block.view_normal, base);
+    }
+}
+#endif
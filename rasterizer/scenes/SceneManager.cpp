@@ -8,11 +8,11 @@
 using namespace std;
 using namespace Rasterizer;
 
-static Scene* getTreeScene() {
+static Scene* getTreeScene(const RenderSettings& settings) {
     Vec3 eye_pos(0.3, -4.05739, 4.46067), center(0, 0, 0.5),
         up((center - eye_pos).cross(Vec3(-1, 0, 0)).normalized());
     Camera cam(45, 1.0f, eye_pos, up, center, 0.01, 50);
-    Scene* scene = new Scene(800, 800, textureFragmentShader);
+    Scene* scene = new Scene(800, 800, TextureShader(), settings);
     Model* model = parseOBJ("assets/tree/12150_Christmas_Tree_V2_L2.obj");
     model->scale(0.017);
     scene->addModel(model);
@@ -22,11 +22,11 @@ static Scene* getTreeScene() {
     scene->sceneSetup();
     return scene;
 }
-static Scene* getMugScene() {
+static Scene* getMugScene(const RenderSettings& settings) {
     Vec3 eye_pos(0, 6, 6), center(0, 0.04, 0),
         up((center - eye_pos).cross(Vec3(-1, 0, 0)).normalized());
     Camera cam(45, 1.0f, eye_pos, up, center, 0.01, 50);
-    Scene* scene = new Scene(800, 800, textureFragmentShader);
+    Scene* scene = new Scene(800, 800, TextureShader(), settings);
     Model* model = parseOBJ("assets/mug/teamugobj.obj");
     model->scale(0.3);
     scene->addModel(model);
@@ -36,10 +36,10 @@ static Scene* getMugScene() {
     return scene;
 }
 
-static Scene* getShoeScene() {
+static Scene* getShoeScene(const RenderSettings& settings) {
     Vec3 eye_pos(0, 6, 6), up(0, 1, 0), center(0, 0, 0);
     Camera cam(45, 1.0f, eye_pos, up, center, 0.1, 30);
-    Scene* scene = new Scene(800, 800, normalFragmentShader);
+    Scene* scene = new Scene(800, 800, NormalShader(), settings);
     Model* model = parseOBJ("assets/shoe/Black_shoe.obj");
     model->scale(0.2);
     scene->addModel(model);
@@ -48,10 +48,10 @@ static Scene* getShoeScene() {
     return scene;
 }
 
-static Scene* getRemScene() {
+static Scene* getRemScene(const RenderSettings& settings) {
     Vec3 eye_pos(0, 1.2, 3), center(0, 0.5, 0),
         up((center - eye_pos).cross(Vec3(-1, 0, 0)).normalized());
-    Scene* scene = new Scene(800, 800, textureFragmentShader);
+    Scene* scene = new Scene(800, 800, TextureShader(), settings);
     Model* model = parseOBJ("assets/rem/Rem.obj");
     scene->addModel(model);
     scene->addLight(new Light(Vec3(0, 5, 3), Vec3(500, 500, 500)));
@@ -62,16 +62,17 @@ static Scene* getRemScene() {
     return scene;
 }
 
-const static map<string, function<Scene*()>> SCENE_MAPPING = {
-    {"shoe", getShoeScene},
-    {"rem", getRemScene},
-    {"mug", getMugScene},
-    {"tree", getTreeScene}};
+const static map<string, function<Scene*(const RenderSettings&)>>
+    SCENE_MAPPING = {{"shoe", getShoeScene},
+                     {"rem", getRemScene},
+                     {"mug", getMugScene},
+                     {"tree", getTreeScene}};
 
-Scene* SceneManager::getPredefinedSceneByName(const std::string& name) {
+Scene* SceneManager::getPredefinedSceneByName(const std::string& name,
+                                              const RenderSettings& settings) {
     auto func = SCENE_MAPPING.find(name);
     if (func != SCENE_MAPPING.end()) {
-        return func->second();
+        return func->second(settings);
     }
     std::cerr << "scene " << name << " is not pre-defined" << std::endl;
     exit(1);
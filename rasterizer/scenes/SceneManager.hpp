@@ -5,7 +5,9 @@
 namespace Rasterizer {
 
 namespace SceneManager {
-Scene* getPredefinedSceneByName(const std::string& name);
+Scene* getPredefinedSceneByName(
+    const std::string& name,
+    const RenderSettings& settings = RenderSettings());
 }  // namespace SceneManager
 }  // namespace Rasterizer
 
@@ -69,23 +69,33 @@ Rasterizer::Model* parseOBJ(const std::string& filename) {
                 mesh_material->Ka_tex = Rasterizer::RGBTexture::loadPNGTexture(
                     mesh_material->map_Ka);
         }
+        // the loader emits a vertex per face corner, the builder shares the
+        // identical ones
+        Rasterizer::MeshBuilder builder(*pm);
         for (int i = 0; i < mesh.Indices.size(); i += 3) {
-            Rasterizer::Triangle* t = new Rasterizer::Triangle();
+            std::array<Rasterizer::Vertex, 3> corners;
             for (int j = 0; j < 3; j++) {
                 auto& vertex = mesh.Vertices[mesh.Indices[i + j]];
-                t->v[j].coord = Rasterizer::Vec3(
+                corners[j].coord = Rasterizer::Vec3(
                     vertex.Position.X, vertex.Position.Y, vertex.Position.Z);
-                t->v[j].normal = Rasterizer::Vec3(
+                corners[j].normal = Rasterizer::Vec3(
                     vertex.Normal.X, vertex.Normal.Y, vertex.Normal.Z);
-                t->v[j].texture_coord =
+                corners[j].texture_coord =
                     Rasterizer::Vec3(vertex.TextureCoordinate.X,
                                      vertex.TextureCoordinate.Y, 0.0);
             }
-            pm->triangles.emplace_back(t);
+            builder.addTriangle(corners);
         }
+        // picks the shader permutation the mesh is drawn with
+        mesh_material->computeFeatures();
         pm->material = mesh_material;
+        pm->computeBounds();
+        pm->buildStreams();
+        pm->buildLODs();
         model->meshes.emplace_back(pm);
     }
+    model->computeBounds();
+    model->buildBVH();
     return model;
 }
 #endif /* OBJPARSER_H */